@@ -1,6 +1,8 @@
 #include <array>
 #include <stdexcept>
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -13,6 +15,8 @@
 class PbrExample : public VulkanApplicationBase {
 public:
     bool displaySkybox = false;
+    // Replaces the helmet with a grid of this many smaller copies, recorded every frame on the worker threads
+    uint32_t stressCopies = 0;
 
     struct Textures {
         VulkanBase::Texture2D mainTex;
@@ -29,11 +33,12 @@ public:
         Model envCube;
     } models;
 
-    struct {
-        VulkanBase::VulkanBuffer object;
-        VulkanBase::VulkanBuffer skybox;
-        VulkanBase::VulkanBuffer uboParams;
-    } uniformBuffers;
+    // Dynamic offsets of this frame's slices, the skybox and the helmet share the same matrices. Ordered by binding number
+    std::array<uint32_t, 2> frameUniforms;
+    // Offsets baked into each slot's static command buffer, a slot is re-recorded when this frame's differ
+    std::vector<std::array<uint32_t, 2>> recordedUniforms;
+    // Matrices of each stress copy, bound in place of frameUniforms[0]
+    std::vector<uint32_t> copyUniforms;
 
     struct {
         glm::mat4 model;
@@ -62,6 +67,7 @@ public:
         VkPipeline skybox;
     } pipelines;
 
+    // Uniforms are dynamic bindings into the frame's slices, so one set per pipeline serves every frame
     struct {
         VkDescriptorSet pbr;
         VkDescriptorSet skybox;
@@ -76,25 +82,32 @@ public:
     }
 
     void prepare() override {
+        // Every copy takes a matrix slice from the frame's uniform region
+        VkDeviceSize stressSize = getUniformRegionSize(sizeof(uboParams)) + (stressCopies + 1) * getUniformRegionSize(sizeof(mvpMatrices));
+        uniformFrameSize = std::max(uniformFrameSize, stressSize);
         VulkanApplicationBase::prepare();
         loadAssets();
-        setupUniformBuffers();
         createDescriptorSetLayout();
         createPipelineLayout();
         createPipeline();
         createDescriptorSets();
-        buildCommandBuffers();
+        recordedUniforms.resize(maxFramesInFlight);
+        copyUniforms.resize(stressCopies);
     }
 
     void loadAssets() {
-        models.helmet.loadFromObj(VulkanBase::Tools::getAssetPath() + "PBR/helmet.obj", vulkanDevice);
-        models.envCube.loadFromObj(VulkanBase::Tools::getAssetPath() + "skybox/cube.obj", vulkanDevice);
-        textures.mainTex.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_basecolor.tga", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice);
-        textures.emissionMap.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_emission.tga", VK_FORMAT_R8G8B8A8_SNORM, vulkanDevice);
-        textures.metallicMap.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_metalness.tga", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice);
-        textures.normalMap.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_normal.tga", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice);
-        textures.occlusionMap.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_occlusion.tga", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice);
-        textures.roughnessMap.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_roughness.tga", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice);
+        // Every asset goes out in one submission, the first frame waits for it on the GPU
+        VulkanBase::AsyncUpload *batch = vulkanDevice->beginUpload();
+        const VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+        const VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        models.helmet.loadFromObj(VulkanBase::Tools::getAssetPath() + "PBR/helmet.obj", vulkanDevice, batch, true, threadPool);
+        models.envCube.loadFromObj(VulkanBase::Tools::getAssetPath() + "skybox/cube.obj", vulkanDevice, batch);
+        textures.mainTex.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_basecolor.tga", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, usage, layout, batch);
+        textures.emissionMap.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_emission.tga", VK_FORMAT_R8G8B8A8_SNORM, vulkanDevice, usage, layout, batch);
+        textures.metallicMap.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_metalness.tga", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, usage, layout, batch);
+        textures.normalMap.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_normal.tga", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, usage, layout, batch);
+        textures.occlusionMap.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_occlusion.tga", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, usage, layout, batch);
+        textures.roughnessMap.loadFromFile(VulkanBase::Tools::getAssetPath() + "PBR/helmet_roughness.tga", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, usage, layout, batch);
         std::array<std::string, 6> filePaths = {
                 VulkanBase::Tools::getAssetPath() + "skybox/right.jpg",
                 VulkanBase::Tools::getAssetPath() + "skybox/left.jpg",
@@ -103,7 +116,8 @@ public:
                 VulkanBase::Tools::getAssetPath() + "skybox/front.jpg",
                 VulkanBase::Tools::getAssetPath() + "skybox/back.jpg",
         };
-        textures.envMap.loadFromFiles(filePaths, VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice);
+        textures.envMap.loadFromFiles(filePaths, VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, usage, layout, batch);
+        vulkanDevice->submitUpload(batch);
     }
 
     void updateUniformBuffers() {
@@ -114,48 +128,47 @@ public:
         mvpMatrices.proj = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 10.0f);
         mvpMatrices.proj[1][1] *= -1;
         mvpMatrices.camPos = glm::vec3(0, 0, 0);
-        memcpy(uniformBuffers.object.mapped, &mvpMatrices, sizeof(mvpMatrices));
-
-        memcpy(uniformBuffers.skybox.mapped, &mvpMatrices, sizeof(mvpMatrices));
+        memcpy(uniformAllocator->mapped(frameUniforms[0]), &mvpMatrices, sizeof(mvpMatrices));
+
+        // Copies are scaled down so the grid covers the helmet's own footprint
+        uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(stressCopies))));
+        glm::mat4 rotation = mvpMatrices.model;
+        for (uint32_t i = 0; i < stressCopies; i++) {
+            float scale = 1.0f / side;
+            glm::vec3 offset((i % side) * 2.0f + 1.0f - side, (i / side) * 2.0f + 1.0f - side, 0.0f);
+            mvpMatrices.model = glm::scale(glm::translate(glm::mat4(1.0f), offset * scale), glm::vec3(scale)) * rotation;
+            memcpy(uniformAllocator->mapped(copyUniforms[i]), &mvpMatrices, sizeof(mvpMatrices));
+        }
+        mvpMatrices.model = rotation;
     }
 
     void updateUBOParams() {
         uboParams.lightPos = glm::vec4(guiParams.lightPos[0], guiParams.lightPos[1], guiParams.lightPos[2], 1.0f);
-        memcpy(uniformBuffers.uboParams.mapped, &uboParams, sizeof(uboParams));
+        memcpy(uniformAllocator->mapped(frameUniforms[1]), &uboParams, sizeof(uboParams));
     }
 
-    void setupUniformBuffers() {
-        vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                   &uniformBuffers.object,
-                                   sizeof(mvpMatrices));
-        vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                   &uniformBuffers.skybox,
-                                   sizeof(mvpMatrices));
-        vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                   &uniformBuffers.uboParams,
-                                   sizeof(uboParams));
-
-        uniformBuffers.object.map();
-        uniformBuffers.skybox.map();
-        uniformBuffers.uboParams.map();
-
-        updateUniformBuffers();
-        updateUBOParams();
+    void allocateFrameUniforms() {
+        frameUniforms[0] = uniformAllocator->allocate(sizeof(mvpMatrices));
+        frameUniforms[1] = uniformAllocator->allocate(sizeof(uboParams));
+        for (auto &offset : copyUniforms) {
+            offset = uniformAllocator->allocate(sizeof(mvpMatrices));
+        }
+        // Usually the same every frame since the slot's region is rewound, but nothing guarantees it
+        if (frameUniforms != recordedUniforms[currentFrame]) {
+            frames[currentFrame].staticDirty = true;
+        }
     }
 
     void createDescriptorSetLayout() {
         std::array<VkDescriptorSetLayoutBinding, 8> bindings{};
         bindings[0].binding = 0;
         bindings[0].descriptorCount = 1;
-        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         bindings[0].pImmutableSamplers = nullptr;
         bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
         bindings[1].binding = 1;
         bindings[1].descriptorCount = 1;
-        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         bindings[1].pImmutableSamplers = nullptr;
         bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
         bindings[2].binding = 2;
@@ -326,7 +339,7 @@ public:
 
     void createDescriptorSets() {
         std::array<VkDescriptorPoolSize, 2> poolSizes{};
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         poolSizes[0].descriptorCount = 4;
         poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         poolSizes[1].descriptorCount = 16;
@@ -345,6 +358,9 @@ public:
         allocateInfo.descriptorSetCount = 1;
         allocateInfo.pSetLayouts = &descriptorSetLayout;
 
+        VkDescriptorBufferInfo mvpBufferInfo = uniformAllocator->descriptor(sizeof(mvpMatrices));
+        VkDescriptorBufferInfo paramsBufferInfo = uniformAllocator->descriptor(sizeof(uboParams));
+
         // Main Object
         VK_CHECK_RESULT(vkAllocateDescriptorSets(vulkanDevice->logicalDevice, &allocateInfo, &descriptorSets.pbr));
 
@@ -353,17 +369,17 @@ public:
         objectDescriptorSets[0].dstSet = descriptorSets.pbr;
         objectDescriptorSets[0].dstBinding = 0;
         objectDescriptorSets[0].dstArrayElement = 0;
-        objectDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        objectDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         objectDescriptorSets[0].descriptorCount = 1;
-        objectDescriptorSets[0].pBufferInfo = &uniformBuffers.object.bufferInfo;
+        objectDescriptorSets[0].pBufferInfo = &mvpBufferInfo;
 
         objectDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         objectDescriptorSets[1].dstSet = descriptorSets.pbr;
         objectDescriptorSets[1].dstBinding = 1;
         objectDescriptorSets[1].dstArrayElement = 0;
-        objectDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        objectDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         objectDescriptorSets[1].descriptorCount = 1;
-        objectDescriptorSets[1].pBufferInfo = &uniformBuffers.uboParams.bufferInfo;
+        objectDescriptorSets[1].pBufferInfo = &paramsBufferInfo;
 
         objectDescriptorSets[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         objectDescriptorSets[2].dstSet = descriptorSets.pbr;
@@ -424,17 +440,17 @@ public:
         skyboxDescriptorSets[0].dstSet = descriptorSets.skybox;
         skyboxDescriptorSets[0].dstBinding = 0;
         skyboxDescriptorSets[0].dstArrayElement = 0;
-        skyboxDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        skyboxDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         skyboxDescriptorSets[0].descriptorCount = 1;
-        skyboxDescriptorSets[0].pBufferInfo = &uniformBuffers.skybox.bufferInfo;
+        skyboxDescriptorSets[0].pBufferInfo = &mvpBufferInfo;
 
         skyboxDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         skyboxDescriptorSets[1].dstSet = descriptorSets.skybox;
         skyboxDescriptorSets[1].dstBinding = 1;
         skyboxDescriptorSets[1].dstArrayElement = 0;
-        skyboxDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        skyboxDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         skyboxDescriptorSets[1].descriptorCount = 1;
-        skyboxDescriptorSets[1].pBufferInfo = &uniformBuffers.uboParams.bufferInfo;
+        skyboxDescriptorSets[1].pBufferInfo = &paramsBufferInfo;
 
         skyboxDescriptorSets[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         skyboxDescriptorSets[2].dstSet = descriptorSets.skybox;
@@ -447,62 +463,59 @@ public:
         vkUpdateDescriptorSets(vulkanDevice->logicalDevice, static_cast<uint32_t>(skyboxDescriptorSets.size()), skyboxDescriptorSets.data(), 0, VK_NULL_HANDLE);
     }
 
-    void buildCommandBuffers() override {
-        VkCommandBufferBeginInfo bufferBeginInfo{};
-        bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        bufferBeginInfo.flags = 0;
-        bufferBeginInfo.pInheritanceInfo = nullptr;
-
-        std::array<VkClearValue, 2> clearValues = {};
-        clearValues[0].color = defaultClearColor;
-        clearValues[1].depthStencil = {1.0f, 0};
-
-        VkRenderPassBeginInfo renderPassBeginInfo{};
-        renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassBeginInfo.renderPass = renderPass;
-        renderPassBeginInfo.renderArea.offset = {0, 0};
-        renderPassBeginInfo.renderArea.extent = {width, height};
-        renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassBeginInfo.pClearValues = clearValues.data();
-
-        for (uint32_t i = 0; i < drawCommandBuffers.size(); i++) {
-            renderPassBeginInfo.framebuffer = frameBuffers[i];
-            VK_CHECK_RESULT(vkBeginCommandBuffer(drawCommandBuffers[i], &bufferBeginInfo));
-            vkCmdBeginRenderPass(drawCommandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(drawCommandBuffers[i], 0, 1, &models.helmet.vertexBuffer.buffer, offsets);
-            vkCmdBindIndexBuffer(drawCommandBuffers[i], models.helmet.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-
-            VkViewport viewport{};
-            viewport.width = (float)width;
-            viewport.height = (float)height;
-            viewport.maxDepth = 1.0f;
-            viewport.minDepth = 0.0f;
-            vkCmdSetViewport(drawCommandBuffers[i], 0, 1, &viewport);
-
-            VkRect2D scissor{};
-            scissor.extent = {width, height};
-            scissor.offset = {0, 0};
-            vkCmdSetScissor(drawCommandBuffers[i], 0, 1,&scissor);
-
-            if (displaySkybox) {
-                vkCmdBindVertexBuffers(drawCommandBuffers[i], 0, 1, &models.envCube.vertexBuffer.buffer, offsets);
-                vkCmdBindIndexBuffer(drawCommandBuffers[i], models.envCube.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-                vkCmdBindPipeline(drawCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.skybox);
-                vkCmdBindDescriptorSets(drawCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.skybox, 0, nullptr);
-                vkCmdDrawIndexed(drawCommandBuffers[i], static_cast<uint32_t>(models.envCube.indices.size()), 1, 0, 0, 0);
-            }
-            vkCmdBindPipeline(drawCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.pbr);
-            vkCmdBindDescriptorSets(drawCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.pbr, 0,nullptr);
-
-            vkCmdDrawIndexed(drawCommandBuffers[i], static_cast<uint32_t>(models.helmet.indices.size()), 1, 0, 0, 0);
-            showGUIWindow(drawCommandBuffers[i]);
-            vkCmdEndRenderPass(drawCommandBuffers[i]);
-            VK_CHECK_RESULT(vkEndCommandBuffer(drawCommandBuffers[i]));
+    // Recorded once per frame slot and replayed until resize, skybox or uniform offset changes invalidate it
+    void buildStaticCommandBuffer(VkCommandBuffer cmdBuffer) override {
+        recordedUniforms[currentFrame] = frameUniforms;
+        // Both models live in the shared geometry pool, one bind covers them
+        models.helmet.bind(cmdBuffer);
+        setViewportAndScissor(cmdBuffer);
+
+        if (displaySkybox) {
+            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.skybox);
+            vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.skybox,
+                                    static_cast<uint32_t>(frameUniforms.size()), frameUniforms.data());
+            models.envCube.draw(cmdBuffer);
+        }
+        if (stressCopies > 0) {
+            return;
+        }
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.pbr);
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.pbr,
+                                static_cast<uint32_t>(frameUniforms.size()), frameUniforms.data());
+
+        models.helmet.draw(cmdBuffer);
+    }
+
+    uint32_t getParallelDrawCount() override {
+        return stressCopies;
+    }
+
+    void buildParallelCommandBuffer(VkCommandBuffer cmdBuffer, uint32_t firstDraw, uint32_t drawCount, uint32_t threadIndex) override {
+        models.helmet.bind(cmdBuffer);
+        setViewportAndScissor(cmdBuffer);
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.pbr);
+        for (uint32_t i = firstDraw; i < firstDraw + drawCount; i++) {
+            std::array<uint32_t, 2> dynamicOffsets = {copyUniforms[i], frameUniforms[1]};
+            vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.pbr,
+                                    static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+            models.helmet.draw(cmdBuffer);
         }
     }
 
+    void setViewportAndScissor(VkCommandBuffer cmdBuffer) {
+        VkViewport viewport{};
+        viewport.width = (float)width;
+        viewport.height = (float)height;
+        viewport.maxDepth = 1.0f;
+        viewport.minDepth = 0.0f;
+        vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.extent = {width, height};
+        scissor.offset = {0, 0};
+        vkCmdSetScissor(cmdBuffer, 0, 1,&scissor);
+    }
+
     void showGUIWindow(VkCommandBuffer cmdBuffer) override {
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -516,32 +529,36 @@ public:
             ImGui::SliderAngle("Rotation Z Axis", &guiParams.zAngle, 0);
             ImGui::InputFloat3("Light Direction", guiParams.lightPos);
         }
+        if (ImGui::Checkbox("Display Skybox", &displaySkybox)) {
+            invalidateStaticCommandBuffers();
+        }
+        showPresentSettings();
         ImGui::End();
+        profiler.drawPanel();
+        memoryReport.drawPanel();
         ImGui::Render();
         ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmdBuffer);
     }
 
+    void updateLateLatchedUniforms() override {
+        updateUniformBuffers();
+    }
+
     void drawFrame() override {
-        vkWaitForFences(vulkanDevice->logicalDevice, 1, &inFlightFences[currentBuffer], VK_TRUE, UINT64_MAX);
-        VulkanApplicationBase::prepareFrame();
+        if (!VulkanApplicationBase::prepareFrame()) {
+            return;
+        }
+        allocateFrameUniforms();
         buildCommandBuffers();
-        updateUniformBuffers();
-        updateUBOParams();
-        vkResetFences(vulkanDevice->logicalDevice, 1, &inFlightFences[currentBuffer]);
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &drawCommandBuffers[currentBuffer];
-        VK_CHECK_RESULT(vkQueueSubmit(vulkanDevice->graphicsQueue, 1, &submitInfo, inFlightFences[currentBuffer]));
+        {
+            VulkanBase::FrameProfiler::CpuScope scope(profiler, VulkanBase::CpuPhase::UniformUpdate);
+            updateUBOParams();
+        }
+        submitFrameCommands();
         VulkanApplicationBase::submitFrame();
     }
 
     ~PbrExample() override {
-        ImGui_ImplVulkan_Shutdown();
-        ImGui_ImplGlfw_Shutdown();
-        ImGui::DestroyContext();
-
-        uniformBuffers.object.cleanUp();
-        uniformBuffers.skybox.cleanUp();
-        uniformBuffers.uboParams.cleanUp();
         models.helmet.cleanUp();
         models.envCube.cleanUp();
         textures.mainTex.cleanUp();
@@ -562,6 +579,12 @@ public:
 
 int main(int argc, char *argv[]) {
     auto *application = new PbrExample();
+    application->parseArguments(argc, argv);
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--stress") {
+            application->stressCopies = static_cast<uint32_t>(std::stoul(argv[i + 1]));
+        }
+    }
     application->setupWindow();
     application->initVulkan();
     application->prepare();
@@ -42,6 +42,7 @@ public:
 
 int main(int argc, char *argv[]) {
     auto *application = new RayTracing();
+    application->parseArguments(argc, argv);
     application->setupWindow();
     application->initVulkan();
     application->prepare();
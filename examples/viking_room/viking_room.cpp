@@ -40,7 +40,9 @@ public:
 
     VkPipelineLayout pipelineLayout;
     VkPipeline pipeline;
-    VkDescriptorSet descriptorSet;
+    // One set per frame in flight, each pointing at that frame's uniform buffer region
+    std::vector<VkDescriptorSet> descriptorSets;
+    VkDeviceSize uniformRegionSize;
     VkDescriptorSetLayout descriptorSetLayout;
     VkDescriptorPool descriptorPool;
 
@@ -58,12 +60,14 @@ public:
         createPipelineLayout();
         createPipeline();
         createDescriptorSets();
-        buildCommandBuffers();
     }
 
     void loadAssets() {
-        models.vikingRoom.loadFromObj(VulkanBase::Tools::getAssetPath() + "viking_room/viking_room.obj", vulkanDevice);
-        textures.mainTexture.loadFromFile(VulkanBase::Tools::getAssetPath() + "viking_room/viking_room.png", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice);
+        VulkanBase::AsyncUpload *batch = vulkanDevice->beginUpload();
+        models.vikingRoom.loadFromObj(VulkanBase::Tools::getAssetPath() + "viking_room/viking_room.obj", vulkanDevice, batch, true, threadPool);
+        textures.mainTexture.loadFromFile(VulkanBase::Tools::getAssetPath() + "viking_room/viking_room.png", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice,
+                                          VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, batch);
+        vulkanDevice->submitUpload(batch);
     }
 
     void updateUniformBuffers() {
@@ -74,14 +78,15 @@ public:
         mvpMatrices.proj = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 10.0f);
         mvpMatrices.proj[1][1] *= -1;
 
-        memcpy(uniformBuffer.uboMats.mapped, &mvpMatrices, sizeof(mvpMatrices));
+        memcpy((char*)uniformBuffer.uboMats.mapped + currentFrame * uniformRegionSize, &mvpMatrices, sizeof(mvpMatrices));
     }
 
     void setupUniformBuffers() {
+        uniformRegionSize = getUniformRegionSize(sizeof(mvpMatrices));
         vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                                    &uniformBuffer.uboMats,
-                                   sizeof(mvpMatrices));
+                                   uniformRegionSize * maxFramesInFlight);
 
         uniformBuffer.uboMats.map();
 
@@ -232,15 +237,15 @@ public:
     void createDescriptorSets() {
         std::array<VkDescriptorPoolSize, 2> poolSizes{};
         poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = 1;
+        poolSizes[0].descriptorCount = maxFramesInFlight;
         poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = 2;
+        poolSizes[1].descriptorCount = 2 * maxFramesInFlight;
 
         VkDescriptorPoolCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
         createInfo.pPoolSizes = poolSizes.data();
-        createInfo.maxSets = 2;
+        createInfo.maxSets = 2 * maxFramesInFlight;
 
         VK_CHECK_RESULT(vkCreateDescriptorPool(vulkanDevice->logicalDevice, &createInfo, nullptr, &descriptorPool));
 
@@ -250,86 +255,66 @@ public:
         allocateInfo.descriptorSetCount = 1;
         allocateInfo.pSetLayouts = &descriptorSetLayout;
 
-        VK_CHECK_RESULT(vkAllocateDescriptorSets(vulkanDevice->logicalDevice, &allocateInfo, &descriptorSet));
-
-        std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
-        writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writeDescriptorSets[0].dstSet = descriptorSet;
-        writeDescriptorSets[0].dstBinding = 0;
-        writeDescriptorSets[0].dstArrayElement = 0;
-        writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        writeDescriptorSets[0].descriptorCount = 1;
-        writeDescriptorSets[0].pBufferInfo = &uniformBuffer.uboMats.bufferInfo;
-
-        writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writeDescriptorSets[1].dstSet = descriptorSet;
-        writeDescriptorSets[1].dstBinding = 1;
-        writeDescriptorSets[1].dstArrayElement = 0;
-        writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        writeDescriptorSets[1].descriptorCount = 1;
-        writeDescriptorSets[1].pImageInfo = &textures.mainTexture.imageInfo;
-
-        vkUpdateDescriptorSets(vulkanDevice->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0,
-                               nullptr);
+        descriptorSets.resize(maxFramesInFlight);
+        for (uint32_t i = 0; i < maxFramesInFlight; i++) {
+            VK_CHECK_RESULT(vkAllocateDescriptorSets(vulkanDevice->logicalDevice, &allocateInfo, &descriptorSets[i]));
+
+            VkDescriptorBufferInfo bufferInfo{uniformBuffer.uboMats.buffer, i * uniformRegionSize, sizeof(mvpMatrices)};
+
+            std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
+            writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writeDescriptorSets[0].dstSet = descriptorSets[i];
+            writeDescriptorSets[0].dstBinding = 0;
+            writeDescriptorSets[0].dstArrayElement = 0;
+            writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            writeDescriptorSets[0].descriptorCount = 1;
+            writeDescriptorSets[0].pBufferInfo = &bufferInfo;
+
+            writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writeDescriptorSets[1].dstSet = descriptorSets[i];
+            writeDescriptorSets[1].dstBinding = 1;
+            writeDescriptorSets[1].dstArrayElement = 0;
+            writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            writeDescriptorSets[1].descriptorCount = 1;
+            writeDescriptorSets[1].pImageInfo = &textures.mainTexture.imageInfo;
+
+            vkUpdateDescriptorSets(vulkanDevice->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0,
+                                   nullptr);
+        }
     }
 
-    void buildCommandBuffers() override {
-        VkCommandBufferBeginInfo bufferBeginInfo{};
-        bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        bufferBeginInfo.flags = 0;
-        bufferBeginInfo.pInheritanceInfo = nullptr;
-
-        std::array<VkClearValue, 2> clearValues = {};
-        clearValues[0].color = defaultClearColor;
-        clearValues[1].depthStencil = {1.0f, 0};
-
-        VkRenderPassBeginInfo renderPassBeginInfo{};
-        renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassBeginInfo.renderPass = renderPass;
-        renderPassBeginInfo.renderArea.offset = {0, 0};
-        renderPassBeginInfo.renderArea.extent = {width, height};
-        renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassBeginInfo.pClearValues = clearValues.data();
-
-        for (uint32_t i = 0; i < drawCommandBuffers.size(); i++) {
-            renderPassBeginInfo.framebuffer = frameBuffers[i];
-            VK_CHECK_RESULT(vkBeginCommandBuffer(drawCommandBuffers[i], &bufferBeginInfo));
-            vkCmdBeginRenderPass(drawCommandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(drawCommandBuffers[i], 0, 1, &models.vikingRoom.vertexBuffer.buffer, offsets);
-            vkCmdBindIndexBuffer(drawCommandBuffers[i], models.vikingRoom.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-
-            VkViewport viewport{};
-            viewport.width = (float)width;
-            viewport.height = (float)height;
-            viewport.maxDepth = 1.0f;
-            viewport.minDepth = 0.0f;
-            vkCmdSetViewport(drawCommandBuffers[i], 0, 1, &viewport);
-
-            VkRect2D scissor{};
-            scissor.extent = {width, height};
-            scissor.offset = {0, 0};
-            vkCmdSetScissor(drawCommandBuffers[i], 0, 1,&scissor);
-
-            vkCmdBindPipeline(drawCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-            vkCmdBindDescriptorSets(drawCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0,
-                                    nullptr);
-
-            vkCmdDrawIndexed(drawCommandBuffers[i], static_cast<uint32_t>(models.vikingRoom.indices.size()), 1, 0, 0, 0);
-            showGUIWindow(drawCommandBuffers[i]);
-            vkCmdEndRenderPass(drawCommandBuffers[i]);
-            VK_CHECK_RESULT(vkEndCommandBuffer(drawCommandBuffers[i]));
-        }
+    void buildStaticCommandBuffer(VkCommandBuffer cmdBuffer) override {
+        models.vikingRoom.bind(cmdBuffer);
+
+        VkViewport viewport{};
+        viewport.width = (float)width;
+        viewport.height = (float)height;
+        viewport.maxDepth = 1.0f;
+        viewport.minDepth = 0.0f;
+        vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.extent = {width, height};
+        scissor.offset = {0, 0};
+        vkCmdSetScissor(cmdBuffer, 0, 1,&scissor);
+
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0,
+                                nullptr);
+
+        models.vikingRoom.draw(cmdBuffer);
+    }
+
+    void updateLateLatchedUniforms() override {
+        updateUniformBuffers();
     }
 
     void drawFrame() override {
-        VulkanApplicationBase::prepareFrame();
+        if (!VulkanApplicationBase::prepareFrame()) {
+            return;
+        }
         buildCommandBuffers();
-        updateUniformBuffers();
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &drawCommandBuffers[currentBuffer];
-        VK_CHECK_RESULT(vkQueueSubmit(vulkanDevice->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
+        submitFrameCommands();
         VulkanApplicationBase::submitFrame();
     }
 
@@ -345,16 +330,15 @@ public:
             ImGui::SliderAngle("Rotation Y Axis", &guiParams.yAngle, 0);
             ImGui::SliderAngle("Rotation Z Axis", &guiParams.zAngle, 0);
         }
+        showPresentSettings();
         ImGui::End();
+        profiler.drawPanel();
+        memoryReport.drawPanel();
         ImGui::Render();
         ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmdBuffer);
     }
 
     ~VikingRoom() override {
-        ImGui_ImplVulkan_Shutdown();
-        ImGui_ImplGlfw_Shutdown();
-        ImGui::DestroyContext();
-
         uniformBuffer.uboMats.cleanUp();
         models.vikingRoom.cleanUp();
         textures.mainTexture.cleanUp();
@@ -369,6 +353,7 @@ public:
 
 int main(int argc, char *argv[]) {
     auto *application = new VikingRoom();
+    application->parseArguments(argc, argv);
     application->setupWindow();
     application->initVulkan();
     application->prepare();
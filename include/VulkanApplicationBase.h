@@ -4,6 +4,8 @@
 #include <vector>
 #include <cstring>
 #include <optional>
+#include <functional>
+#include <chrono>
 
 #define GLFW_INCLUDE_VULKAN
 #define GLFW_EXPOSE_NATIVE_WIN32
@@ -14,7 +16,12 @@
 
 #include "VulkanTools.h"
 #include "VulkanDevice.h"
+#include "VulkanUniformAllocator.h"
 #include "VulkanSwapchain.h"
+#include "VulkanProfiler.h"
+#include "VulkanMemoryReport.h"
+#include "VulkanThreadPool.h"
+#include "VulkanFrameArena.h"
 #include "Camera.hpp"
 
 #include "imgui_impl_glfw.h"
@@ -27,6 +34,8 @@ const bool enableValidation = false;
 const bool enableValidation = true;
 #endif
 
+const uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+
 const std::vector<const char*> validationLayers = {
         "VK_LAYER_KHRONOS_validation"
 };
@@ -45,16 +54,40 @@ public:
     Camera camera;
     std::string title = "Richelieu Renderer";
     std::string name = "RichelieuRenderer";
-    uint32_t apiVersion = VK_API_VERSION_1_0;
+    uint32_t apiVersion = VK_API_VERSION_1_2;
+    // Number of frames the CPU may record ahead of the GPU, clamped to [1, MAX_FRAMES_IN_FLIGHT]
+    uint32_t maxFramesInFlight = 2;
+    // Render into offscreen targets without a window or swapchain and write every frame to disk
+    bool headless = false;
+    uint32_t headlessFrameCount = 60;
+    std::string headlessOutputPrefix = "frame";
+    // Profiler statistics are exported to <prefix>.csv and <prefix>.json, the memory report to <prefix>.memory.json, on exit when set
+    std::string profileOutputPrefix;
+    // Worker threads for parallel command recording, 0 picks the hardware concurrency
+    uint32_t recordingThreadCount = 0;
+    VulkanBase::PresentPolicy presentPolicy = VulkanBase::PresentPolicy::LowLatency;
+    // Frame rate cap applied before input is polled, 0 leaves it to the present policy
+    float frameRateLimit = 0.0f;
+    // Cap used by PresentPolicy::PowerSaving while frameRateLimit is 0
+    float powerSavingFrameRate = 30.0f;
+    // Load and store ops of the main render pass, set before prepare(). The MSAA color and depth attachments are
+    // transient when neither loaded nor stored and then live in lazily allocated memory where the device offers it
+    struct {
+        VkAttachmentLoadOp colorLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        VkAttachmentStoreOp colorStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        VkAttachmentLoadOp depthLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        VkAttachmentStoreOp depthStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        VkAttachmentStoreOp resolveStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+    } mainPassAttachments;
     struct {
         VkImage image;
-        VkDeviceMemory memory;
+        VulkanBase::Allocation allocation;
         VkImageView imageView;
     } depthStencil;
 
     struct {
         VkImage image;
-        VkDeviceMemory memory;
+        VulkanBase::Allocation allocation;
         VkImageView imageView;
     } colorResources;
 
@@ -66,6 +99,8 @@ public:
     virtual void prepare();
     virtual void showGUIWindow(VkCommandBuffer cmdBuffer);
     void renderLoop();
+    void parseArguments(int argc, char *argv[]);
+    void setPresentPolicy(VulkanBase::PresentPolicy policy);
     void setKeyStatus(int key, int action);
 
     static VkResult createDebugUtilsMessengerExt(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger);
@@ -73,36 +108,121 @@ public:
 
     void createInstance();
 protected:
-    GLFWwindow* window;
+    GLFWwindow* window = nullptr;
     VkInstance instance;
     VulkanBase::VulkanDevice *vulkanDevice;
-    VkSurfaceKHR surface;
-    VulkanBase::VulkanSwapchain *swapchain;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    VulkanBase::VulkanSwapchain *swapchain = nullptr;
+    // Format and count of the presented images, taken from the swapchain or the offscreen targets
+    VkFormat colorFormat;
+    uint32_t imageCount;
+    struct OffscreenTarget {
+        VkImage image;
+        VulkanBase::Allocation allocation;
+        VkImageView imageView;
+        VkBuffer readbackBuffer;
+        // Persistently mapped through the allocator
+        VulkanBase::Allocation readbackAllocation;
+        // Frame number copied into the readback buffer but not written to disk yet, -1 if none
+        int64_t pendingFrame = -1;
+    };
+    // Headless stand-in for the swapchain images, one per frame slot
+    std::vector<OffscreenTarget> offscreenTargets;
+    uint32_t headlessFrameIndex = 0;
     std::vector<VkFramebuffer> frameBuffers;
-    std::vector<VkCommandBuffer> drawCommandBuffers;
     std::vector<VkShaderModule> shaderModules;
     VkDescriptorPool imGuiDescriptorPool;
     VkCommandPool cmdPool;
     VkRenderPass renderPass;
     VkPipelineCache pipelineCache;
+    // Index of the acquired swapchain image
     uint32_t currentBuffer = 0;
+    // Index of the frame-in-flight slot being recorded
+    uint32_t currentFrame = 0;
     VkSubmitInfo submitInfo;
     VkPipelineStageFlags waitStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    struct {
+    struct FrameResources {
+        VkCommandBuffer commandBuffer;
+        // Secondary holding the static scene, only re-recorded after invalidateStaticCommandBuffers()
+        VkCommandBuffer staticCommandBuffer;
+        // Secondary holding per-frame content such as the GUI, re-recorded every frame
+        VkCommandBuffer overlayCommandBuffer;
+        bool staticDirty = true;
         VkSemaphore presentCompleteSemaphore;
         VkSemaphore renderCompleteSemaphore;
-    } semaphores;
-    std::vector<VkFence> inFlightFences;
+        // Timeline value of the last submission from this slot
+        uint64_t submitValue = 0;
+        // When the input used by this frame's late latched uniforms was sampled
+        std::chrono::steady_clock::time_point inputSampleTime;
+    };
+    std::vector<FrameResources> frames;
+    struct ThreadCommandPool {
+        VkCommandPool commandPool;
+        std::vector<VkCommandBuffer> commandBuffers;
+        uint32_t usedCount = 0;
+    };
+    // Indexed by frame slot, then by worker thread, so each pool is only touched by one thread
+    std::vector<std::vector<ThreadCommandPool>> threadCommandPools;
+    VulkanBase::ThreadPool *threadPool = nullptr;
+    // Smallest batch of draws handed to a worker, below this a secondary buffer costs more than it saves
+    uint32_t minDrawsPerTask = 64;
+    // Timeline value of the frame that last rendered into each swapchain image
+    std::vector<uint64_t> imagesInFlight;
+    // Extra semaphores the next frame submission waits on, e.g. compute work it consumes
+    VulkanBase::QueueSubmission frameDependencies;
+    // Transient CPU memory per frame slot, reset by prepareFrame() once the slot's previous frame has retired
+    std::vector<VulkanBase::LinearArena *> frameArenas;
+    // Scratch per worker thread, rewound after every parallel recording task
+    std::vector<VulkanBase::LinearArena *> workerArenas;
+    // Per-frame uniform slices, rewound to the current slot's region by prepareFrame()
+    VulkanBase::UniformAllocator *uniformAllocator = nullptr;
+    // Bytes of each slot's uniform region, raised before prepare() by scenes with many slices per frame
+    VkDeviceSize uniformFrameSize = VulkanBase::UniformAllocator::DEFAULT_FRAME_SIZE;
     VkFormat depthFormat;
+    VulkanBase::FrameProfiler profiler;
+    VulkanBase::MemoryReport memoryReport;
 
     virtual int getDeviceScore(VkPhysicalDevice physicalDevice);
-    virtual void buildCommandBuffers() = 0;
-    void prepareFrame();
+    virtual void buildCommandBuffers();
+    virtual void buildStaticCommandBuffer(VkCommandBuffer cmdBuffer);
+    virtual void buildOverlayCommandBuffer(VkCommandBuffer cmdBuffer);
+    // Draws re-recorded every frame across the worker threads, 0 disables parallel recording
+    virtual uint32_t getParallelDrawCount();
+    // Called concurrently from worker threads, must set its own dynamic state and only read shared data.
+    // workerArenas[threadIndex] serves scratch memory and is rewound after the call.
+    virtual void buildParallelCommandBuffer(VkCommandBuffer cmdBuffer, uint32_t firstDraw, uint32_t drawCount, uint32_t threadIndex);
+    void invalidateStaticCommandBuffers();
+    VulkanBase::LinearArena &frameArena();
+    VkDeviceSize getUniformRegionSize(VkDeviceSize size) const;
+    // Called right before vkQueueSubmit, for uniform data that should reflect the freshest input. Camera matrices belong
+    // here so they pick up the input polled right before submission
+    virtual void updateLateLatchedUniforms();
+    void waitBeforeFrame(VkSemaphore semaphore, VkPipelineStageFlags stage);
+    void submitFrameCommands();
+    void showPresentSettings();
+    bool prepareFrame();
     void submitFrame();
     virtual void drawFrame();
 
 private:
     VkDebugUtilsMessengerEXT debugMessenger;
+    std::chrono::steady_clock::time_point nextFrameDeadline;
+    // Reused every frame so its vectors keep their capacity
+    VulkanBase::QueueSubmission frameSubmission;
+    // Swapchains replaced by a resize, with the frames still to submit before they go to the deletion queue
+    struct PendingSwapchain {
+        VulkanBase::RetiredSwapchain swapchain;
+        uint32_t framesLeft;
+    };
+    std::vector<PendingSwapchain> pendingSwapchains;
+    // Submitted frames whose input latency is still open, oldest first since submissions and presents complete in order
+    struct LatencySample {
+        std::chrono::steady_clock::time_point inputSampleTime;
+        uint64_t submitValue;
+        // 0 without VK_KHR_present_wait, the sample then ends when the frame's GPU work retires instead
+        uint64_t presentId;
+    };
+    std::vector<LatencySample> latencySamples;
 
     std::vector<const char *> getRequiredExtensions();
     VkPhysicalDevice pickPhysicalDevice();
@@ -110,11 +230,19 @@ private:
     void createFrameBuffer();
     void createRenderPass();
     void windowResize();
+    void waitForFrameDeadline();
+    void collectLatencySamples();
     void createCommandPool();
     void createSyncPrimitives();
     void createCommandBuffers();
+    void createThreadCommandPools();
+    void recordParallelCommandBuffers(VkCommandBufferInheritanceInfo inheritanceInfo, VulkanBase::ArenaVector<VkCommandBuffer> &commandBuffers);
     void setupColorResources();
+    VulkanBase::Allocation allocateAttachment(VkImage image, bool transient);
     void createPipelineCache();
     void createImGuiComponent();
+    void createOffscreenTargets();
+    void destroyOffscreenTargets();
+    void writeOffscreenTarget(uint32_t index);
 };
 #endif
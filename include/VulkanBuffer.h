@@ -5,13 +5,18 @@
 
 #include <vulkan/vulkan.h>
 #include "VulkanTools.h"
+#include "VulkanMemoryAllocator.h"
 
 namespace VulkanBase {
+    class VulkanDevice;
+
     class VulkanBuffer {
     public:
         VkDevice logicalDevice;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        Allocation allocation;
+        MemoryAllocator *allocator = nullptr;
+        VulkanDevice *device = nullptr;
         VkDescriptorBufferInfo bufferInfo{};
         VkDeviceSize size = 0;
         VkDeviceSize alignment = 0;
@@ -24,8 +29,9 @@ namespace VulkanBase {
         void unmap();
         void flush(VkDeviceSize deviceSize = VK_WHOLE_SIZE, VkDeviceSize offset = 0) const;
         void setDescriptor(VkDeviceSize deviceSize = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
-        void bind(VkDeviceSize offset = 0) const;
         void cleanUp();
+        // Hands the buffer to the device's deletion queue instead of destroying it while frames may still read it
+        void retire();
     };
 }
 
@@ -3,14 +3,73 @@
 
 #include "vulkan/vulkan.h"
 #include "VulkanBuffer.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanStagingRing.h"
+#include "VulkanOneShotCommandPool.h"
+#include "VulkanFrameArena.h"
 
+#include <array>
 #include <vector>
+#include <functional>
 
 namespace VulkanBase {
+    class GeometryPool;
+
     struct QueueIndices {
         uint32_t graphicsIdx;
         uint32_t presentIdx;
+        // Transfer-only family when the device has one, otherwise the graphics family
+        uint32_t transferIdx;
+        // Compute family without graphics when the device has one, otherwise the graphics family
+        uint32_t computeIdx;
+    };
+
+    // One batch of command buffers and the semaphores it waits on and signals
+    struct QueueSubmission {
+        std::vector<VkCommandBuffer> commandBuffers;
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitStages;
+        // Timeline values to wait for, ignored for binary semaphores
+        std::vector<uint64_t> waitValues;
+        std::vector<VkSemaphore> signalSemaphores;
+
+        void wait(VkSemaphore semaphore, VkPipelineStageFlags stage, uint64_t value = 0) {
+            waitSemaphores.push_back(semaphore);
+            waitStages.push_back(stage);
+            waitValues.push_back(value);
+        }
+        void signal(VkSemaphore semaphore) {
+            signalSemaphores.push_back(semaphore);
+        }
+        // Keeps the capacity, so a submission reused every frame stops allocating
+        void clear() {
+            commandBuffers.clear();
+            waitSemaphores.clear();
+            waitStages.clear();
+            waitValues.clear();
+            signalSemaphores.clear();
+        }
     };
+
+    // Copies recorded on the transfer queue, plus the graphics-side barriers that take ownership of the results.
+    // Loaders accept one as a batch so many assets go out in a single submission.
+    struct AsyncUpload {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        std::vector<VkBufferMemoryBarrier> acquireBufferBarriers;
+        std::vector<VkImageMemoryBarrier> acquireImageBarriers;
+        VkPipelineStageFlags dstStageMask = 0;
+        // Run once the GPU has finished the upload, typically to free staging memory
+        std::vector<std::function<void()>> onComplete;
+    };
+
+    // Usage and budget come from VK_EXT_memory_budget, without it they fall back to our own reservations and the heap size
+    struct HeapBudget {
+        VkDeviceSize size;
+        VkMemoryHeapFlags flags;
+        VkDeviceSize budget;
+        VkDeviceSize usage;
+    };
+
     class VulkanDevice {
     public:
         VkPhysicalDevice physicalDevice;
@@ -23,20 +82,98 @@ namespace VulkanBase {
         VkCommandPool commandPool;
         VkQueue graphicsQueue;
         VkQueue presentQueue;
+        VkQueue transferQueue;
+        VkQueue computeQueue;
+        VkCommandPool computeCommandPool;
         QueueIndices queueIndices;
         VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+        MemoryAllocator *allocator = nullptr;
+        StagingRing *stagingRing = nullptr;
+        bool memoryBudgetSupported = false;
+        // VK_KHR_present_id and VK_KHR_present_wait, only looked for when the swapchain extension is enabled
+        bool presentWaitSupported = false;
 
         VulkanDevice(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
-        void createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer *buffer, VkDeviceMemory *memory, VkDeviceSize size, void *data = nullptr);
+        void createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer *buffer, Allocation *allocation, VkDeviceSize size, void *data = nullptr);
         void createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VulkanBuffer *pBuffer, VkDeviceSize size, void *data = nullptr);
         void copyBuffer(VulkanBuffer *src, VulkanBuffer *dest, VkQueue queue, VkBufferCopy *copyRegion);
         uint32_t getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, VkBool32 *hasFound = nullptr) const;
-        VkCommandBuffer createCommandBuffer(VkCommandBufferLevel level, bool begin);
-        void flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free = true) const;
+        // Primary buffers without an explicit pool come from a recycled per-thread graphics pool, flushing hands them back
+        VkCommandBuffer createCommandBuffer(VkCommandBufferLevel level, bool begin, VkCommandPool pool = VK_NULL_HANDLE);
+        void flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free = true, VkCommandPool pool = VK_NULL_HANDLE);
+        // Returns the timeline value that marks the submission as complete. The value names its queue, so checking or
+        // waiting on it never involves work submitted to other queues
+        uint64_t submit(VkQueue queue, const QueueSubmission &submission);
+        VkSemaphore getTimelineSemaphore(VkQueue queue) const;
+        bool isRetired(uint64_t value);
+        void waitRetired(uint64_t value);
+        VkSemaphore createSemaphore() const;
+        bool hasDedicatedComputeQueue() const;
+        bool hasDedicatedTransferQueue() const;
+        bool extensionSupported(const char *extensionName) const;
+        // Fills heaps indexed by memory heap, queried fresh on every call, and returns the heap count
+        uint32_t getMemoryBudget(std::array<HeapBudget, VK_MAX_MEMORY_HEAPS> &heaps) const;
+        AsyncUpload *beginUpload();
+        // Carves source space for a copy recorded into upload and fills it with data unless that is null
+        StagingRegion stage(AsyncUpload *upload, const void *data, VkDeviceSize size, VkDeviceSize alignment = 4);
+        // Only the given range changes queue family, so disjoint ranges of a shared buffer can be uploaded independently
+        void releaseBuffer(AsyncUpload *upload, VkBuffer buffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask,
+                           VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+        void releaseImage(AsyncUpload *upload, VkImage image, VkImageSubresourceRange subresourceRange, VkImageLayout newLayout,
+                          VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+        // Returns the timeline value that marks the upload, including its ownership acquire, as complete
+        uint64_t submitUpload(AsyncUpload *upload);
+        // Submits and blocks until the upload has completed
+        void flushUpload(AsyncUpload *upload);
+        void collectUploads(bool wait = false);
+        // Runs destroy once the GPU is done with the resource, lastUse defaults to everything submitted so far
+        void retire(std::function<void()> destroy, uint64_t lastUse = 0);
+        void collectRetired(bool force = false);
+        // Shared mesh storage, created on first use, every caller must use the same vertex stride
+        GeometryPool *getGeometryPool(uint32_t vertexStride);
         ~VulkanDevice();
 
     private:
+        struct PendingUpload {
+            AsyncUpload *upload;
+            VkCommandBuffer acquireCommandBuffer;
+            uint64_t value;
+        };
+        std::vector<PendingUpload> pendingUploads;
+
+        // Values are drawn from one counter shifted up, with the index of the submitting queue's timeline in the low
+        // bits, so they still increase on every semaphore
+        static const uint32_t TIMELINE_INDEX_BITS = 2;
+        static const uint32_t MAX_TIMELINES = 1u << TIMELINE_INDEX_BITS;
+
+        struct RetiredResource {
+            // Per timeline, 0 where the resource waits for nothing
+            std::array<uint64_t, MAX_TIMELINES> lastUses;
+            std::function<void()> destroy;
+        };
+        std::vector<RetiredResource> retiredResources;
+        GeometryPool *geometryPool = nullptr;
+        OneShotCommandPool *graphicsOneShotPool = nullptr;
+        OneShotCommandPool *transferOneShotPool = nullptr;
+        // Scratch arrays of submit(), which is only called from the render thread
+        LinearArena scratchArena{16 * 1024};
+
+        // One timeline per distinct queue
+        struct QueueTimeline {
+            VkQueue queue;
+            VkSemaphore semaphore;
+            uint64_t lastSubmitted;
+            uint64_t completed;
+        };
+        std::vector<QueueTimeline> timelines;
+        uint64_t submissionCount = 0;
+
         void createLogicalDevice();
+        void createTimelines();
+        void reclaimStaging();
+        QueueTimeline &getTimeline(VkQueue queue);
+        QueueTimeline &getTimeline(uint64_t value);
+        bool isRetired(QueueTimeline &timeline, uint64_t value);
         VkCommandPool createCommandPool(uint32_t queueFamilyIdx, VkCommandPoolCreateFlags createFlags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT) const;
     };
 }
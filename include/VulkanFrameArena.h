@@ -0,0 +1,90 @@
+#ifndef RICHELIEU_VULKANFRAMEARENA_H
+#define RICHELIEU_VULKANFRAMEARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VulkanBase {
+    // Bump allocator for transient CPU data, nothing is freed individually. Overflow spills into extra blocks
+    // which reset() folds into one larger block, so a steady workload stops touching the global heap.
+    class LinearArena {
+    public:
+        static const size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+        // Position to rewind to, see ArenaScope
+        struct Marker {
+            size_t block;
+            size_t offset;
+        };
+
+        explicit LinearArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+        ~LinearArena();
+        LinearArena(const LinearArena &) = delete;
+        LinearArena &operator=(const LinearArena &) = delete;
+        void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+        void reset();
+        Marker mark() const;
+        void rewind(Marker marker);
+        size_t capacity() const;
+
+    private:
+        struct Block {
+            char *data;
+            size_t size;
+        };
+
+        std::vector<Block> blocks;
+        size_t currentBlock = 0;
+        size_t offset = 0;
+    };
+
+    // Releases everything allocated from the arena during its lifetime, for scratch memory in nested or worker code
+    class ArenaScope {
+    public:
+        explicit ArenaScope(LinearArena &arena) : arena(arena), marker(arena.mark()) {}
+        ~ArenaScope() {
+            arena.rewind(marker);
+        }
+        ArenaScope(const ArenaScope &) = delete;
+        ArenaScope &operator=(const ArenaScope &) = delete;
+
+    private:
+        LinearArena &arena;
+        LinearArena::Marker marker;
+    };
+
+    // Lets standard containers draw from an arena, deallocation is a no-op until the arena is reset
+    template<typename T>
+    class ArenaAllocator {
+    public:
+        typedef T value_type;
+
+        explicit ArenaAllocator(LinearArena &arena) : arena(&arena) {}
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+        T *allocate(size_t count) {
+            return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T)));
+        }
+        void deallocate(T *, size_t) {}
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U> &other) const {
+            return arena == other.arena;
+        }
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U> &other) const {
+            return arena != other.arena;
+        }
+
+    private:
+        template<typename U> friend class ArenaAllocator;
+        LinearArena *arena;
+    };
+
+    template<typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}
+
+#endif
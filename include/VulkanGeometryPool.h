@@ -0,0 +1,67 @@
+#ifndef RICHELIEU_VULKANGEOMETRYPOOL_H
+#define RICHELIEU_VULKANGEOMETRYPOOL_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+#include "VulkanDevice.h"
+
+namespace VulkanBase {
+    // Where a mesh lives in the pool, in vertices and indices rather than bytes
+    struct GeometryRange {
+        uint32_t firstVertex = 0;
+        uint32_t vertexCount = 0;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+    };
+
+    // One vertex buffer and one 32 bit index buffer shared by every mesh, so draws of different meshes need no rebinding.
+    // Indices stay local to their mesh and are offset by firstVertex as the vertexOffset of the draw.
+    class GeometryPool {
+    public:
+        static const VkDeviceSize DEFAULT_VERTEX_CAPACITY = 64ull * 1024 * 1024;
+        static const VkDeviceSize DEFAULT_INDEX_CAPACITY = 32ull * 1024 * 1024;
+
+        VkBuffer vertexBuffer = VK_NULL_HANDLE;
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+
+        GeometryPool(VulkanDevice *device, uint32_t vertexStride, VkDeviceSize vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+                     VkDeviceSize indexCapacity = DEFAULT_INDEX_CAPACITY);
+        ~GeometryPool();
+        // Throws when either buffer has no free run large enough
+        GeometryRange allocate(uint32_t vertexCount, uint32_t indexCount);
+        void free(const GeometryRange &range);
+        void bind(VkCommandBuffer cmdBuffer) const;
+        uint32_t getVertexStride() const;
+        VkDeviceSize vertexByteOffset(const GeometryRange &range) const;
+        VkDeviceSize indexByteOffset(const GeometryRange &range) const;
+
+    private:
+        // First fit over runs of free elements, sorted and merged like the memory allocator's free lists
+        class RangeList {
+        public:
+            explicit RangeList(uint32_t capacity);
+            bool allocate(uint32_t count, uint32_t &first);
+            void release(uint32_t first, uint32_t count);
+
+        private:
+            struct Range {
+                uint32_t first;
+                uint32_t count;
+            };
+            std::vector<Range> freeRanges;
+        };
+
+        VulkanDevice *device;
+        uint32_t vertexStride;
+        Allocation vertexAllocation;
+        Allocation indexAllocation;
+        RangeList vertexRanges;
+        RangeList indexRanges;
+        std::mutex mutex;
+    };
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef RICHELIEU_VULKANMEMORYALLOCATOR_H
+#define RICHELIEU_VULKANMEMORYALLOCATOR_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace VulkanBase {
+    // What a resource is used for, only recorded for the memory report
+    enum class MemoryCategory {
+        Mesh = 0,
+        Texture,
+        RenderTarget,
+        Staging,
+        Uniform,
+        Other,
+        Count
+    };
+
+    const char *memoryCategoryName(MemoryCategory category);
+
+    // A range of device memory handed out by the MemoryAllocator, bound at memory + offset
+    struct Allocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        // Persistently mapped pointer to offset, null unless the memory is host visible
+        void *mapped = nullptr;
+        uint32_t memoryType = 0;
+        // Index of the pool the range came from, or DEDICATED when it owns its memory
+        uint32_t pool = 0;
+        MemoryCategory category = MemoryCategory::Other;
+
+        static const uint32_t DEDICATED = UINT32_MAX;
+    };
+
+    struct MemoryStatistics {
+        uint32_t deviceMemoryCount = 0;
+        uint32_t allocationCount = 0;
+        uint32_t dedicatedCount = 0;
+        VkDeviceSize reservedBytes = 0;
+        VkDeviceSize usedBytes = 0;
+        std::array<VkDeviceSize, static_cast<size_t>(MemoryCategory::Count)> categoryBytes{};
+        // Indexed by memory heap, reserved counts whole blocks while used only counts live allocations
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapReservedBytes{};
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapUsedBytes{};
+    };
+
+    // Sub-allocates resources from large per memory type blocks instead of one vkAllocateMemory each
+    class MemoryAllocator {
+    public:
+        static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+        MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+        ~MemoryAllocator();
+        // Allocates and binds memory for the resource
+        Allocation allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags propertyFlags, bool deviceAddress = false,
+                                  MemoryCategory category = MemoryCategory::Other);
+        Allocation allocateImage(VkImage image, VkMemoryPropertyFlags propertyFlags, bool linearTiling = false,
+                                 MemoryCategory category = MemoryCategory::Other);
+        void free(Allocation &allocation);
+        // Makes host writes visible on memory without HOST_COHERENT, offset and size are relative to the allocation
+        void flush(const Allocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+        uint32_t getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags propertyFlags) const;
+        MemoryStatistics getStatistics();
+
+    private:
+        // Linear and optimal resources live in separate blocks so bufferImageGranularity never applies
+        enum class ResourceKind {
+            Linear = 0,
+            Optimal,
+            DeviceAddress,
+            Count
+        };
+
+        struct Range {
+            VkDeviceSize offset;
+            VkDeviceSize size;
+        };
+
+        struct Block {
+            VkDeviceMemory memory;
+            VkDeviceSize size;
+            VkDeviceSize used;
+            void *mapped;
+            // Sorted by offset, neighbours are merged on free
+            std::vector<Range> freeRanges;
+        };
+
+        struct Pool {
+            uint32_t memoryType;
+            ResourceKind kind;
+            VkDeviceSize blockSize;
+            std::vector<Block> blocks;
+            uint32_t allocationCount;
+        };
+
+        VkDevice logicalDevice;
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        VkDeviceSize nonCoherentAtomSize;
+        std::vector<Pool> pools;
+        uint32_t dedicatedCount = 0;
+        VkDeviceSize dedicatedBytes = 0;
+        std::array<VkDeviceSize, static_cast<size_t>(MemoryCategory::Count)> categoryBytes{};
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapReservedBytes{};
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapUsedBytes{};
+        std::mutex mutex;
+
+        Allocation allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags propertyFlags, ResourceKind kind, bool dedicated,
+                            VkBuffer buffer, VkImage image);
+        Allocation allocateDedicated(const VkMemoryRequirements &requirements, uint32_t memoryType, ResourceKind kind, VkBuffer buffer, VkImage image);
+        bool allocateFromBlock(Block &block, const VkMemoryRequirements &requirements, Allocation &allocation) const;
+        VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryType, ResourceKind kind, VkBuffer buffer, VkImage image, void **mapped);
+        void freeMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType);
+        void track(const Allocation &allocation, bool allocated);
+    };
+}
+
+#endif
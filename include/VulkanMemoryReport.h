@@ -0,0 +1,26 @@
+#ifndef RICHELIEU_VULKANMEMORYREPORT_H
+#define RICHELIEU_VULKANMEMORYREPORT_H
+
+#include <array>
+#include <string>
+
+#include "VulkanDevice.h"
+
+namespace VulkanBase {
+    // Per heap budget and per category usage of the device memory, shown in ImGui or written to JSON
+    class MemoryReport {
+    public:
+        // Heaps past this fraction of their budget are highlighted, the driver may start paging soon after
+        float warningThreshold = 0.9f;
+
+        void init(VulkanDevice *device);
+        void drawPanel();
+        bool exportJSON(const std::string &filePath) const;
+
+    private:
+        VulkanDevice *device = nullptr;
+        std::array<HeapBudget, VK_MAX_MEMORY_HEAPS> heaps;
+    };
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef RICHELIEU_VULKANMESHCACHE_H
+#define RICHELIEU_VULKANMESHCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "VulkanModel.h"
+
+namespace VulkanBase {
+    // Read only view of a whole file mapped into the address space
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        ~MappedFile();
+        bool open(const std::string &filePath);
+        void close();
+        const char *data() const;
+        size_t size() const;
+
+    private:
+        const char *mapped = nullptr;
+        size_t length = 0;
+        // File and mapping handles, only kept open on Windows
+        void *fileHandle = nullptr;
+        void *mappingHandle = nullptr;
+    };
+
+    // Fixed layout at the start of a cache file, the blobs follow at 64 byte aligned offsets
+    struct MeshCacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexStride;
+        uint32_t flags;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint64_t sourceSize;
+        // Nanoseconds since the epoch, or 100ns FILETIME ticks on Windows
+        int64_t sourceModified;
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        // Over the vertex and index blobs
+        uint64_t checksum;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    namespace MeshCache {
+        const uint32_t VERSION = 4;
+        // Set when the cached mesh went through the MeshOptimizer passes
+        const uint32_t FLAG_OPTIMIZED = 1;
+
+        std::string cachePath(const std::string &sourcePath);
+        // Maps the cache next to sourcePath, false when it is missing, corrupt, written with other flags or the
+        // source changed size or modification time since
+        bool open(const std::string &sourcePath, uint32_t flags, MappedFile &file, const MeshCacheHeader *&header);
+        bool write(const std::string &sourcePath, uint32_t flags, const std::vector<Vertex> &vertices,
+                   const std::vector<uint32_t> &indices, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax);
+    }
+}
+
+#endif
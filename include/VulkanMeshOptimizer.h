@@ -0,0 +1,34 @@
+#ifndef RICHELIEU_VULKANMESHOPTIMIZER_H
+#define RICHELIEU_VULKANMESHOPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VulkanModel.h"
+
+namespace VulkanBase {
+    // Average transformed vertices per triangle and per vertex through a simulated FIFO post-transform cache
+    struct VertexCacheStatistics {
+        float acmr = 0.0f;
+        float atvr = 0.0f;
+    };
+
+    namespace MeshOptimizer {
+        const uint32_t DEFAULT_CACHE_SIZE = 16;
+
+        VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount,
+                                                 uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+        // Tipsify triangle order, fills clusters with the first triangle of each run that starts from a cold cache
+        void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount, std::vector<uint32_t> &clusters,
+                                 uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+        // Splits the clusters further where it costs at most threshold times their ACMR, then draws the ones facing
+        // out of the mesh first so they occlude the rest
+        void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices, std::vector<uint32_t> clusters,
+                              float threshold = 1.05f, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+        // Renumbers vertices in the order the indices first reference them, unreferenced ones are dropped
+        void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+    }
+}
+
+#endif
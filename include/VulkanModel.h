@@ -10,6 +10,8 @@
 //#include "assimp/postprocess.h"
 
 #include "VulkanDevice.h"
+#include "VulkanGeometryPool.h"
+#include "VulkanThreadPool.h"
 
 struct Vertex {
     glm::vec3 pos = glm::vec3();
@@ -25,28 +27,38 @@ class Model {
 public:
     VulkanBase::VulkanDevice *pDevice;
 
+    // Left empty when the mesh is loaded from its binary cache, which is copied into staging directly
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
     std::string path;
+    glm::vec3 boundsMin = glm::vec3();
+    glm::vec3 boundsMax = glm::vec3();
 
-    struct {
-        int count;
-        VkBuffer buffer;
-        VkDeviceMemory memory;
-    } vertexBuffer;
-
-    struct {
-        int count;
-        VkBuffer buffer;
-        VkDeviceMemory memory;
-    } indexBuffer;
+    // Range in the device's shared geometry pool, firstIndex and firstVertex feed vkCmdDrawIndexed directly
+    VulkanBase::GeometryRange geometry;
 
     void loadFromFile(std::string filePath, VulkanBase::VulkanDevice *device);
-    void loadFromObj(std::string filePath, VulkanBase::VulkanDevice *device);
+    // Records into batch when given, otherwise the upload is submitted on its own. Normals missing from the file are
+    // generated and tangents always are. optimize reorders triangles and
+    // vertices for the post-transform cache, overdraw and vertex fetch before the upload. The result is cached next to
+    // the file and reused until the file changes. With a threadPool the file is parsed in parallel by ObjParser, without
+    // one by tinyobj, which stays the reference the parallel path has to match
+    void loadFromObj(std::string filePath, VulkanBase::VulkanDevice *device, VulkanBase::AsyncUpload *batch = nullptr,
+                     bool optimize = false, VulkanBase::ThreadPool *threadPool = nullptr);
+    // Binds the shared pool, which stays valid for every other model drawn after this one
+    void bind(VkCommandBuffer cmdBuffer) const;
+    void draw(VkCommandBuffer cmdBuffer, uint32_t instanceCount = 1) const;
     void cleanUp();
+    // Lets a replaced model be dropped without waiting for the frames still drawing it
+    void retire();
+    // Appends the welded vertices and indices of filePath as parsed by tinyobj, the reference ObjParserTest compares
+    // ObjParser against
+    void loadWithTinyObj(const std::string &filePath);
 
 private:
-    void createBuffer();
+    void optimizeMesh();
+    void createBuffer(VulkanBase::AsyncUpload *batch, const Vertex *vertexData, uint32_t vertexCount, const uint32_t *indexData,
+                      uint32_t indexCount);
 //    void processNode(aiNode *node, const aiScene *scene);
 //    void processMesh(aiMesh *mesh, const aiScene *scene);
 };
@@ -0,0 +1,20 @@
+#ifndef RICHELIEU_VULKANOBJPARSER_H
+#define RICHELIEU_VULKANOBJPARSER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "VulkanModel.h"
+#include "VulkanThreadPool.h"
+
+namespace VulkanBase {
+    namespace ObjParser {
+        // Parses the v, vt, vn and f records of filePath in line aligned chunks on threadPool and welds the face corners,
+        // producing the same vertices and indices as Model's tinyobj path. Polygons are split into fans, every other
+        // record is skipped
+        void load(const std::string &filePath, ThreadPool *threadPool, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+    }
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef RICHELIEU_VULKANONESHOTCOMMANDPOOL_H
+#define RICHELIEU_VULKANONESHOTCOMMANDPOOL_H
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace VulkanBase {
+    // Recycles primary command buffers for one-shot work on a queue family. Every thread records from its own
+    // VkCommandPool, so loaders on worker threads never contend on pool access.
+    class OneShotCommandPool {
+    public:
+        OneShotCommandPool(VkDevice logicalDevice, uint32_t queueFamilyIndex);
+        ~OneShotCommandPool();
+        // Not begun, beginning it resets whatever it recorded last time
+        VkCommandBuffer acquire();
+        // Only once the GPU has finished executing it, may be called from any thread
+        void recycle(VkCommandBuffer commandBuffer);
+        bool owns(VkCommandBuffer commandBuffer);
+
+    private:
+        struct ThreadPool {
+            VkCommandPool pool;
+            std::vector<VkCommandBuffer> freeBuffers;
+        };
+
+        VkDevice logicalDevice;
+        uint32_t queueFamilyIndex;
+        std::mutex mutex;
+        std::unordered_map<std::thread::id, ThreadPool *> threadPools;
+        std::unordered_map<VkCommandBuffer, ThreadPool *> owners;
+    };
+}
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef RICHELIEU_VULKANPROFILER_H
+#define RICHELIEU_VULKANPROFILER_H
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+#include "VulkanDevice.h"
+
+namespace VulkanBase {
+    enum class CpuPhase {
+        FrameWait = 0,
+        Acquire,
+        Record,
+        UniformUpdate,
+        Submit,
+        Present,
+        Count
+    };
+
+    struct TimingStatistics {
+        double min = 0.0;
+        double avg = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        size_t samples = 0;
+    };
+
+    // Fixed size window of the most recent samples, in milliseconds
+    class RollingHistory {
+    public:
+        explicit RollingHistory(size_t capacity = 240);
+        void push(double value);
+        TimingStatistics statistics() const;
+
+    private:
+        std::vector<double> values;
+        // Scratch for the percentiles, kept so statistics() doesn't allocate every frame
+        mutable std::vector<double> sorted;
+        size_t capacity;
+        size_t next = 0;
+    };
+
+    class FrameProfiler {
+    public:
+        // Times a CPU phase for as long as the scope is alive
+        class CpuScope {
+        public:
+            CpuScope(FrameProfiler &profiler, CpuPhase phase);
+            ~CpuScope();
+
+        private:
+            FrameProfiler &profiler;
+            CpuPhase phase;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        static const uint32_t MAX_GPU_SCOPES = 16;
+
+        void init(VulkanDevice *device, uint32_t frameCount, size_t historySize = 240);
+        void destroy();
+        void beginFrame();
+        // Drops the frame begun by beginFrame(), for a frame that ends up never being submitted
+        void discardFrame();
+        void addCpuTime(CpuPhase phase, double milliseconds);
+        void addLatency(const std::string &name, double milliseconds);
+        void collectGpuResults(uint32_t frameIndex);
+        void resetQueries(VkCommandBuffer cmdBuffer, uint32_t frameIndex);
+        void beginGpuScope(VkCommandBuffer cmdBuffer, uint32_t frameIndex, const std::string &name);
+        void endGpuScope(VkCommandBuffer cmdBuffer, uint32_t frameIndex);
+        void drawPanel();
+        bool exportCSV(const std::string &filePath) const;
+        bool exportJSON(const std::string &filePath) const;
+        static const char *phaseName(CpuPhase phase);
+
+    private:
+        struct GpuFrame {
+            VkQueryPool queryPool = VK_NULL_HANDLE;
+            std::vector<std::string> scopeNames;
+            uint32_t queryCount = 0;
+            // Scopes begun but not yet ended, as indices into scopeNames
+            std::vector<uint32_t> openScopes;
+        };
+
+        VkDevice logicalDevice = VK_NULL_HANDLE;
+        bool gpuTimingSupported = false;
+        float timestampPeriod = 1.0f;
+        uint64_t timestampMask = ~0ULL;
+        size_t historySize = 240;
+        std::vector<GpuFrame> gpuFrames;
+
+        std::array<double, static_cast<size_t>(CpuPhase::Count)> currentCpuTimes{};
+        bool frameStarted = false;
+        std::chrono::steady_clock::time_point frameStart;
+        std::vector<RollingHistory> cpuHistories;
+        RollingHistory frameHistory;
+        std::map<std::string, RollingHistory> gpuHistories;
+        std::map<std::string, RollingHistory> latencyHistories;
+    };
+}
+
+#endif
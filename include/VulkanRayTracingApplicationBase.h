@@ -7,7 +7,7 @@ namespace VulkanBase {
     struct AccelerationStructure {
         VkAccelerationStructureKHR handle;
         uint64_t address = 0;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        Allocation allocation;
         VkBuffer buffer = VK_NULL_HANDLE;
         VulkanDevice &device;
 
@@ -18,7 +18,7 @@ namespace VulkanBase {
 
     struct RayTracingScratchBuffer {
         uint64_t address = 0;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        Allocation allocation;
         VkBuffer buffer = VK_NULL_HANDLE;
         VulkanDevice &device;
 
@@ -64,7 +64,7 @@ namespace VulkanBase {
         VkPhysicalDeviceAccelerationStructureFeaturesKHR enabledAccelerationStructureFeatures{};
 
         struct StorageImage {
-            VkDeviceMemory memory = VK_NULL_HANDLE;
+            Allocation allocation;
             VkImage image = VK_NULL_HANDLE;
             VkImageView view = VK_NULL_HANDLE;
             VkFormat format;
@@ -0,0 +1,58 @@
+#ifndef RICHELIEU_VULKANSTAGINGRING_H
+#define RICHELIEU_VULKANSTAGINGRING_H
+
+#include <cstdint>
+#include <deque>
+
+#include <vulkan/vulkan.h>
+#include "VulkanMemoryAllocator.h"
+
+namespace VulkanBase {
+    // Part of a staging buffer the host writes through mapped and a transfer reads from at offset
+    struct StagingRegion {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void *mapped = nullptr;
+    };
+
+    // Persistently mapped host coherent buffer that upload staging is carved from in FIFO order
+    class StagingRing {
+    public:
+        static const VkDeviceSize DEFAULT_SIZE = 32ull * 1024 * 1024;
+
+        StagingRing(VkDevice logicalDevice, MemoryAllocator *allocator, VkDeviceSize size = DEFAULT_SIZE);
+        ~StagingRing();
+        // Returns false when the free space can't hold size bytes until older regions are released
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment, const void *owner, StagingRegion &region);
+        // Tags the regions of owner with the timeline value of the transfer that reads them
+        void submit(const void *owner, uint64_t value);
+        // Value guarding the oldest region, 0 when nothing is in use or its transfer is not submitted yet
+        uint64_t oldestValue() const;
+        // Releases every region guarded by oldestValue()
+        void releaseOldest();
+        VkDeviceSize capacity() const;
+
+    private:
+        struct Span {
+            // Head after the region, the tail moves here once it is released
+            VkDeviceSize end;
+            // Region plus the alignment padding or wrapped tail in front of it
+            VkDeviceSize bytes;
+            const void *owner;
+            uint64_t value;
+        };
+
+        VkDevice logicalDevice;
+        MemoryAllocator *allocator;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        Allocation allocation;
+        VkDeviceSize size;
+        VkDeviceSize head = 0;
+        VkDeviceSize tail = 0;
+        VkDeviceSize used = 0;
+        std::deque<Span> spans;
+    };
+}
+
+#endif
@@ -14,12 +14,30 @@ namespace VulkanBase {
         VkImageView imageView;
     };
 
+    enum class PresentPolicy {
+        // Mailbox or immediate, frames are never held back by vblank
+        LowLatency,
+        // FIFO relaxed where supported, otherwise FIFO, with the minimum image count. The application caps the frame rate
+        // to powerSavingFrameRate unless a limit is set
+        PowerSaving,
+        // FIFO with an extra image to absorb frame time spikes
+        VSync
+    };
+
+    // Handles replaced by a recreation, still in use by frames presented before it
+    struct RetiredSwapchain {
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+        std::vector<VkImageView> imageViews;
+    };
+
     class VulkanSwapchain {
     private:
         VkInstance instance;
         VkDevice logicalDevice;
         VkPhysicalDevice physicalDevice;
         VkSurfaceKHR surface;
+        PFN_vkWaitForPresentKHR vkWaitForPresent = nullptr;
+        uint64_t lastPresentId = 0;
 
     public:
         VkFormat colorFormat;
@@ -28,11 +46,18 @@ namespace VulkanBase {
         uint32_t imageCount;
         std::vector<SwapchainBuffer> swapchainBuffers;
         QueueIndices queueIndices;
+        PresentPolicy presentPolicy = PresentPolicy::LowLatency;
+        // Tags every present with an id that waitForPresent() accepts, needs the device's presentWaitSupported
+        bool presentWaitSupported = false;
 
         void initSurface();
-        void createSwapchain(uint32_t *width, uint32_t *height);
+        void createSwapchain(uint32_t *width, uint32_t *height, RetiredSwapchain *retired = nullptr);
+        void destroyRetired(const RetiredSwapchain &retired) const;
         VkResult acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t *imageIndex);
-        VkResult queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore);
+        // presentId receives the id of this present, 0 when presents are not tagged
+        VkResult queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore, uint64_t *presentId = nullptr);
+        // VK_SUCCESS once the present with this id or a later one reached the display, VK_TIMEOUT before
+        VkResult waitForPresent(uint64_t presentId, uint64_t timeout);
         VulkanSwapchain(QueueIndices _queueIndices, VkPhysicalDevice _physicalDevice, VkDevice _device, VkSurfaceKHR _surface);
         ~VulkanSwapchain();
     };
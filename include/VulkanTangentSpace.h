@@ -0,0 +1,22 @@
+#ifndef RICHELIEU_VULKANTANGENTSPACE_H
+#define RICHELIEU_VULKANTANGENTSPACE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "VulkanModel.h"
+
+namespace VulkanBase {
+    namespace TangentSpace {
+        // Fills vertices without a normal with the area weighted normal of every face around their position, so UV
+        // seams stay smooth
+        void generateNormals(std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices);
+        // Per face UV gradients projected onto the vertex normal and angle weighted like MikkTSpace, with the bitangent
+        // sign in tangent.w. Not MikkTSpace compatible: tangents are averaged per welded vertex and only split on
+        // handedness, where MikkTSpace also splits corners whose tangents diverge and lets degenerate faces inherit from
+        // their neighbours. Indices may change and vertices may grow
+        void generateTangents(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+    }
+}
+
+#endif
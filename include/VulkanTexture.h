@@ -18,7 +18,7 @@ namespace VulkanBase {
         VkImage image;
         VkImageLayout imageLayout;
         VkDescriptorImageInfo imageInfo;
-        VkDeviceMemory deviceMemory;
+        Allocation allocation;
         VkImageView imageView;
         uint32_t width;
         uint32_t height;
@@ -27,11 +27,14 @@ namespace VulkanBase {
         VkSampler sampler;
 
         void cleanUp();
+        // Destroys the texture once the GPU has finished every submission issued so far
+        void retire();
     };
 
     class Texture2D : public Texture {
     public:
-        void loadFromFile(const std::string& filePath, VkFormat format, VulkanDevice *device, VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        // Records into batch when given, otherwise the upload is submitted on its own
+        void loadFromFile(const std::string& filePath, VkFormat format, VulkanDevice *device, VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, AsyncUpload *batch = nullptr);
         void loadFromBuffer(void* buffer, VkDeviceSize bufferSize, VkFormat format, uint32_t texWidth, uint32_t texHeight, VulkanDevice *device, VkFilter filter = VK_FILTER_LINEAR, VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     };
 
@@ -42,7 +45,7 @@ namespace VulkanBase {
 
     class TextureCubeMap : public Texture {
     public:
-        void loadFromFiles(const std::array<std::string, 6> &filePaths, VkFormat format, VulkanDevice *device, VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        void loadFromFiles(const std::array<std::string, 6> &filePaths, VkFormat format, VulkanDevice *device, VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, AsyncUpload *batch = nullptr);
     };
 }
 #endif
@@ -0,0 +1,37 @@
+#ifndef RICHELIEU_VULKANTHREADPOOL_H
+#define RICHELIEU_VULKANTHREADPOOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VulkanBase {
+    class ThreadPool {
+    public:
+        explicit ThreadPool(uint32_t threadCount);
+        ~ThreadPool();
+        uint32_t size() const;
+        // Runs task(taskIndex, threadIndex) for every task and blocks until all of them have finished
+        void parallelFor(uint32_t taskCount, const std::function<void(uint32_t, uint32_t)> &task);
+
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable workFinished;
+        const std::function<void(uint32_t, uint32_t)> *currentTask = nullptr;
+        uint32_t taskCount = 0;
+        uint32_t nextTask = 0;
+        uint32_t finishedTasks = 0;
+        std::exception_ptr error;
+        bool stopping = false;
+
+        void workerLoop(uint32_t threadIndex);
+    };
+}
+
+#endif
@@ -29,6 +29,8 @@ namespace VulkanBase {
                             VkPipelineStageFlags destStageFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
         std::string errorString(VkResult res);
         uint32_t alignedSize(uint32_t val, uint32_t aligned);
+        VkDeviceSize alignedVkSize(VkDeviceSize val, VkDeviceSize aligned);
+        void writePPM(const std::string &filePath, const unsigned char *rgba, uint32_t width, uint32_t height);
     }
 }
 #endif
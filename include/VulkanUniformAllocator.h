@@ -0,0 +1,43 @@
+#ifndef RICHELIEU_VULKANUNIFORMALLOCATOR_H
+#define RICHELIEU_VULKANUNIFORMALLOCATOR_H
+
+#include <cstdint>
+#include <cstring>
+
+#include <vulkan/vulkan.h>
+#include "VulkanBuffer.h"
+#include "VulkanDevice.h"
+
+namespace VulkanBase {
+    // Bump allocator over one persistently mapped uniform buffer, split into a region per frame in flight.
+    // Slices are bound through VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC with the returned offsets.
+    class UniformAllocator {
+    public:
+        static const VkDeviceSize DEFAULT_FRAME_SIZE = 256 * 1024;
+
+        UniformAllocator(VulkanDevice *device, uint32_t frameCount, VkDeviceSize frameSize = DEFAULT_FRAME_SIZE);
+        ~UniformAllocator();
+        // Rewinds to the start of the frame's region, whose previous submission must have retired
+        void beginFrame(uint32_t frameIndex);
+        // Returns the dynamic offset of an aligned slice of at least size bytes
+        uint32_t allocate(VkDeviceSize size);
+        template<typename T>
+        uint32_t push(const T &data) {
+            uint32_t offset = allocate(sizeof(T));
+            memcpy(mapped(offset), &data, sizeof(T));
+            return offset;
+        }
+        void *mapped(uint32_t offset) const;
+        // Buffer info for a dynamic binding whose slices are at most range bytes
+        VkDescriptorBufferInfo descriptor(VkDeviceSize range) const;
+
+    private:
+        VulkanBuffer buffer;
+        VkDeviceSize frameSize;
+        VkDeviceSize alignment;
+        VkDeviceSize frameStart = 0;
+        VkDeviceSize head = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef RICHELIEU_VULKANVERTEXWELDER_H
+#define RICHELIEU_VULKANVERTEXWELDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VulkanModel.h"
+
+namespace VulkanBase {
+    // Collapses face corners sharing position, UV and normal into one vertex through an open addressing table
+    class VertexWelder {
+    public:
+        // Appends to vertices, expectedVertices sizes the table so typical meshes never rehash
+        VertexWelder(std::vector<Vertex> &vertices, size_t expectedVertices);
+        // Index of the vertex equal to vertex, appended first when it was not seen yet
+        uint32_t weld(const Vertex &vertex);
+        // Equal vertices hash the same, so the hash can also split welding across independent welders
+        static uint32_t hash(const Vertex &vertex);
+
+    private:
+        static bool equal(const Vertex &a, const Vertex &b);
+        void rehash(size_t capacity);
+
+        std::vector<Vertex> &vertices;
+        // Vertex index plus one, 0 marks an empty slot
+        std::vector<uint32_t> slots;
+        uint32_t mask = 0;
+    };
+}
+
+#endif
@@ -72,14 +72,11 @@ void main(){
     emission *= 0.5f;
     vec3 light = normalize(uboParams.lightPos.xyz - positionWS);
     // vec3 light = normalize(vec3(-15.0f, -7.5f, 15.0f) - positionWS);
-    vec3 normalTS = texture(normalMap, uv).rgb;
-    vec3 q1 = dFdx(positionWS);
-    vec3 q2 = dFdy(positionWS);
-    vec2 st1 = dFdx(uv);
-    vec2 st2 = dFdy(uv);
-    vec3 n = normalize(normalTS);
-    vec3 t = normalize(q1 * st2.t - q2 * st1.t);
-    vec3 b = normalize(cross(n, t));
+    vec3 normalTS = texture(normalMap, uv).rgb * 2.0 - 1.0;
+    // Interpolated vertex TBN, left unnormalized before the final normalize as MikkTSpace expects
+    vec3 n = normalWS;
+    vec3 t = tangentWS.xyz;
+    vec3 b = tangentWS.w * cross(n, t);
     mat3 tbn = mat3(t, b, n);
     vec3 normal = normalize(tbn * normalTS);
 
@@ -4,6 +4,9 @@
 #include <stdexcept>
 #include <map>
 #include <array>
+#include <algorithm>
+#include <cstdio>
+#include <thread>
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugMessage(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
                                                          VkDebugUtilsMessageTypeFlagsEXT type,
@@ -80,22 +83,84 @@ static void checkResult(VkResult res) {
 	}
 }
 
+static bool isTransient(VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp) {
+    return loadOp != VK_ATTACHMENT_LOAD_OP_LOAD && storeOp == VK_ATTACHMENT_STORE_OP_DONT_CARE;
+}
+
 static void framebufferResizedCallback(GLFWwindow *window, int width, int height) {
     auto app = reinterpret_cast<VulkanApplicationBase *>(glfwGetWindowUserPointer(window));
     app->framebufferResized = true;
 }
 
 void VulkanApplicationBase::initVulkan() {
+    if (headless) {
+        // Without a surface the swapchain extension can't be enabled
+        deviceExtensions.erase(std::remove_if(deviceExtensions.begin(), deviceExtensions.end(), [](const char *extension) {
+            return strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0;
+        }), deviceExtensions.end());
+    }
     createInstance();
     VkPhysicalDevice physicalDevice = pickPhysicalDevice();
     vulkanDevice = new VulkanBase::VulkanDevice(physicalDevice, surface);
-    swapchain = new VulkanBase::VulkanSwapchain(vulkanDevice->queueIndices, vulkanDevice->physicalDevice, vulkanDevice->logicalDevice, surface);
+    if (!headless) {
+        swapchain = new VulkanBase::VulkanSwapchain(vulkanDevice->queueIndices, vulkanDevice->physicalDevice, vulkanDevice->logicalDevice, surface);
+        swapchain->presentPolicy = presentPolicy;
+        swapchain->presentWaitSupported = vulkanDevice->presentWaitSupported;
+    }
+    // A minimized window may never complete its presents, so the oldest samples are dropped past this
+    latencySamples.reserve(16);
+}
+
+void VulkanApplicationBase::parseArguments(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--frames" && i + 1 < argc) {
+            headlessFrameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--output" && i + 1 < argc) {
+            headlessOutputPrefix = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profileOutputPrefix = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            recordingThreadCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--present" && i + 1 < argc) {
+            std::string policy(argv[++i]);
+            if (policy == "low-latency") {
+                presentPolicy = VulkanBase::PresentPolicy::LowLatency;
+            } else if (policy == "power-saving") {
+                presentPolicy = VulkanBase::PresentPolicy::PowerSaving;
+            } else if (policy == "vsync") {
+                presentPolicy = VulkanBase::PresentPolicy::VSync;
+            } else {
+                throw std::runtime_error("unknown present policy: " + policy + "!");
+            }
+        } else if (arg == "--fps" && i + 1 < argc) {
+            frameRateLimit = std::stof(argv[++i]);
+        } else if (arg == "--width" && i + 1 < argc) {
+            width = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--height" && i + 1 < argc) {
+            height = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+    }
+}
+
+void VulkanApplicationBase::setPresentPolicy(VulkanBase::PresentPolicy policy) {
+    presentPolicy = policy;
+    if (swapchain != nullptr) {
+        swapchain->presentPolicy = policy;
+        // Picked up by the resize path after the next present
+        framebufferResized = true;
+    }
 }
 
 void VulkanApplicationBase::setupWindow() {
+    if (headless) {
+        return;
+    }
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
     const char *windowTitle = title.c_str();
     window = glfwCreateWindow(width, height, windowTitle, nullptr, nullptr);
     glfwSetWindowUserPointer(window, this);
@@ -104,16 +169,32 @@ void VulkanApplicationBase::setupWindow() {
 }
 
 void VulkanApplicationBase::prepare() {
+    maxFramesInFlight = std::max(1u, std::min(maxFramesInFlight, MAX_FRAMES_IN_FLIGHT));
     createCommandPool();
-    swapchain->createSwapchain(&width, &height);
+    if (headless) {
+        createOffscreenTargets();
+    } else {
+        swapchain->createSwapchain(&width, &height);
+        colorFormat = swapchain->colorFormat;
+        imageCount = swapchain->imageCount;
+    }
     createCommandBuffers();
+    createThreadCommandPools();
+    profiler.init(vulkanDevice, maxFramesInFlight);
+    memoryReport.init(vulkanDevice);
+    uniformAllocator = new VulkanBase::UniformAllocator(vulkanDevice, maxFramesInFlight, uniformFrameSize);
+    for (uint32_t i = 0; i < maxFramesInFlight; i++) {
+        frameArenas.push_back(new VulkanBase::LinearArena());
+    }
     createSyncPrimitives();
     setupDepthStencil();
     setupColorResources();
     createRenderPass();
     createPipelineCache();
     createFrameBuffer();
-    createImGuiComponent();
+    if (!headless) {
+        createImGuiComponent();
+    }
 }
 
 void VulkanApplicationBase::setupDepthStencil() {
@@ -128,19 +209,11 @@ void VulkanApplicationBase::setupDepthStencil() {
     createInfo.arrayLayers = 1;
     createInfo.samples = vulkanDevice->msaaSamples;
     createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    createInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    bool transient = isTransient(mainPassAttachments.depthLoadOp, mainPassAttachments.depthStoreOp);
+    createInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
 
     VK_CHECK_RESULT(vkCreateImage(vulkanDevice->logicalDevice, &createInfo, nullptr, &depthStencil.image));
-
-    VkMemoryRequirements memoryRequirements{};
-    vkGetImageMemoryRequirements(vulkanDevice->logicalDevice, depthStencil.image, &memoryRequirements);
-
-    VkMemoryAllocateInfo allocateInfo{};
-    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocateInfo.allocationSize = memoryRequirements.size;
-    allocateInfo.memoryTypeIndex = vulkanDevice->getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    VK_CHECK_RESULT(vkAllocateMemory(vulkanDevice->logicalDevice, &allocateInfo, nullptr, &depthStencil.memory));
-    VK_CHECK_RESULT(vkBindImageMemory(vulkanDevice->logicalDevice, depthStencil.image, depthStencil.memory, 0));
+    depthStencil.allocation = allocateAttachment(depthStencil.image, transient);
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -162,29 +235,22 @@ void VulkanApplicationBase::setupColorResources() {
     imageInfo.extent = {width, height, 1};
     imageInfo.mipLevels = 1;
     imageInfo.arrayLayers = 1;
-    imageInfo.format = swapchain->colorFormat;
+    imageInfo.format = colorFormat;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    bool transient = isTransient(mainPassAttachments.colorLoadOp, mainPassAttachments.colorStoreOp);
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
     imageInfo.samples = vulkanDevice->msaaSamples;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
     VK_CHECK_RESULT(vkCreateImage(vulkanDevice->logicalDevice, &imageInfo, nullptr, &colorResources.image));
-
-    VkMemoryRequirements memoryRequirements;
-    vkGetImageMemoryRequirements(vulkanDevice->logicalDevice, colorResources.image, &memoryRequirements);
-    VkMemoryAllocateInfo allocateInfo{};
-    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocateInfo.allocationSize = memoryRequirements.size;
-    allocateInfo.memoryTypeIndex = vulkanDevice->getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    VK_CHECK_RESULT(vkAllocateMemory(vulkanDevice->logicalDevice, &allocateInfo, nullptr, &colorResources.memory));
-    VK_CHECK_RESULT(vkBindImageMemory(vulkanDevice->logicalDevice, colorResources.image, colorResources.memory, 0));
+    colorResources.allocation = allocateAttachment(colorResources.image, transient);
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image = colorResources.image;
     viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = swapchain->colorFormat;
+    viewInfo.format = colorFormat;
     viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     viewInfo.subresourceRange.baseMipLevel = 0;
     viewInfo.subresourceRange.levelCount = 1;
@@ -194,6 +260,21 @@ void VulkanApplicationBase::setupColorResources() {
     VK_CHECK_RESULT(vkCreateImageView(vulkanDevice->logicalDevice, &viewInfo, nullptr, &colorResources.imageView));
 }
 
+VulkanBase::Allocation VulkanApplicationBase::allocateAttachment(VkImage image, bool transient) {
+    VkMemoryPropertyFlags propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if (transient) {
+        // Tile based GPUs never commit lazily allocated memory for attachments that stay on chip
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(vulkanDevice->logicalDevice, image, &requirements);
+        VkBool32 lazilyAllocated = VK_FALSE;
+        vulkanDevice->getMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &lazilyAllocated);
+        if (lazilyAllocated) {
+            propertyFlags |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        }
+    }
+    return vulkanDevice->allocator->allocateImage(image, propertyFlags, false, VulkanBase::MemoryCategory::RenderTarget);
+}
+
 void VulkanApplicationBase::createFrameBuffer() {
     std::array<VkImageView, 3> attachments = {};
 
@@ -210,9 +291,9 @@ void VulkanApplicationBase::createFrameBuffer() {
     createInfo.pAttachments = attachments.data();
     createInfo.layers = 1;
 
-    frameBuffers.resize(swapchain->imageCount);
+    frameBuffers.resize(imageCount);
     for (uint32_t i = 0; i < frameBuffers.size(); i++) {
-        attachments[2] = swapchain->swapchainBuffers[i].imageView;
+        attachments[2] = headless ? offscreenTargets[i].imageView : swapchain->swapchainBuffers[i].imageView;
         VK_CHECK_RESULT(vkCreateFramebuffer(vulkanDevice->logicalDevice, &createInfo, nullptr, &frameBuffers[i]));
     }
 }
@@ -220,32 +301,37 @@ void VulkanApplicationBase::createFrameBuffer() {
 void VulkanApplicationBase::createRenderPass() {
     std::array<VkAttachmentDescription, 3> attachments = {};
     // Color attachment
-    attachments[0].format = swapchain->colorFormat;
+    attachments[0].format = colorFormat;
     attachments[0].samples = vulkanDevice->msaaSamples;
-    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].loadOp = mainPassAttachments.colorLoadOp;
+    // Only the resolve target is read after the pass unless a derived class asks otherwise
+    attachments[0].storeOp = mainPassAttachments.colorStoreOp;
     attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // Loaded contents are whatever the previous frame left, so the layout must carry over
+    attachments[0].initialLayout = mainPassAttachments.colorLoadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+                                                                                                 : VK_IMAGE_LAYOUT_UNDEFINED;
     attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     // Depth attachment
     attachments[1].format = depthFormat;
     attachments[1].samples = vulkanDevice->msaaSamples;
-    attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[1].loadOp = mainPassAttachments.depthLoadOp;
+    attachments[1].storeOp = mainPassAttachments.depthStoreOp;
     attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[1].initialLayout = mainPassAttachments.depthLoadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+                                                                                                 : VK_IMAGE_LAYOUT_UNDEFINED;
     attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
     // Resolve attachment
-    attachments[2].format = swapchain->colorFormat;
+    attachments[2].format = colorFormat;
     attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
     attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[2].storeOp = mainPassAttachments.resolveStoreOp;
     attachments[2].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     attachments[2].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     attachments[2].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    attachments[2].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // Headless targets are copied to a host buffer instead of being presented
+    attachments[2].finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     // Attachment Reference
     VkAttachmentReference colorAttachmentRef{};
@@ -269,15 +355,25 @@ void VulkanApplicationBase::createRenderPass() {
     description.pResolveAttachments = &colorAttachmentResolveRef;
 
     // SubPass Dependency
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask =
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstStageMask =
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    std::array<VkSubpassDependency, 2> dependencies = {};
+    // Every frame slot shares the depth and MSAA color images, so the previous frame's attachment writes have to finish
+    // before this frame clears or loads them
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    // Make the resolved image visible to the readback copy
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
     // Render Pass
     VkRenderPassCreateInfo createInfo{};
@@ -286,30 +382,191 @@ void VulkanApplicationBase::createRenderPass() {
     createInfo.pAttachments = attachments.data();
     createInfo.subpassCount = 1;
     createInfo.pSubpasses = &description;
-    createInfo.dependencyCount = 1;
-    createInfo.pDependencies = &dependency;
+    createInfo.dependencyCount = headless ? 2 : 1;
+    createInfo.pDependencies = dependencies.data();
     VK_CHECK_RESULT(vkCreateRenderPass(vulkanDevice->logicalDevice, &createInfo, nullptr, &renderPass));
 }
 
-void VulkanApplicationBase::prepareFrame() {
-    VkResult result = swapchain->acquireNextImage(semaphores.presentCompleteSemaphore, &currentBuffer);
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-        windowResize();
-        return;
-    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-        throw std::runtime_error("failed to acquire swapchain image!");
+bool VulkanApplicationBase::prepareFrame() {
+    FrameResources &frame = frames[currentFrame];
+    profiler.beginFrame();
+    {
+        // Only block until the GPU has retired the work previously submitted from this slot
+        VulkanBase::FrameProfiler::CpuScope scope(profiler, VulkanBase::CpuPhase::FrameWait);
+        vulkanDevice->waitRetired(frame.submitValue);
     }
+    collectLatencySamples();
+    vulkanDevice->collectRetired();
+    vulkanDevice->collectUploads();
+    profiler.collectGpuResults(currentFrame);
+
+    if (headless) {
+        // Each slot renders into its own target, whose previous frame is complete now
+        currentBuffer = currentFrame;
+        writeOffscreenTarget(currentBuffer);
+    } else {
+        VkResult result;
+        {
+            VulkanBase::FrameProfiler::CpuScope scope(profiler, VulkanBase::CpuPhase::Acquire);
+            result = swapchain->acquireNextImage(frame.presentCompleteSemaphore, &currentBuffer);
+        }
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            windowResize();
+            // Nothing is recorded or submitted for this frame, so it must not count as a sample
+            profiler.discardFrame();
+            return false;
+        } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            throw std::runtime_error("failed to acquire swapchain image!");
+        }
+
+        // Images may be acquired out of order, so the image can still be rendered by another slot
+        vulkanDevice->waitRetired(imagesInFlight[currentBuffer]);
+        submitInfo.pWaitSemaphores = &frame.presentCompleteSemaphore;
+        submitInfo.pSignalSemaphores = &frame.renderCompleteSemaphore;
+    }
+
+    // Only rewound once the frame is certain to be recorded and submitted
+    uniformAllocator->beginFrame(currentFrame);
+    frameArenas[currentFrame]->reset();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
+    return true;
 }
 
 void VulkanApplicationBase::submitFrame() {
-    VkResult result = swapchain->queuePresent(vulkanDevice->presentQueue, currentBuffer, semaphores.renderCompleteSemaphore);
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+    if (headless) {
+        offscreenTargets[currentBuffer].pendingFrame = headlessFrameIndex++;
+        currentFrame = (currentFrame + 1) % maxFramesInFlight;
+        return;
+    }
+    VkResult result;
+    uint64_t presentId;
+    {
+        VulkanBase::FrameProfiler::CpuScope scope(profiler, VulkanBase::CpuPhase::Present);
+        result = swapchain->queuePresent(vulkanDevice->presentQueue, currentBuffer, frames[currentFrame].renderCompleteSemaphore, &presentId);
+    }
+    if (latencySamples.size() == latencySamples.capacity()) {
+        latencySamples.erase(latencySamples.begin());
+    }
+    latencySamples.push_back({frames[currentFrame].inputSampleTime, frames[currentFrame].submitValue, presentId});
+    currentFrame = (currentFrame + 1) % maxFramesInFlight;
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+        framebufferResized = false;
         windowResize();
         return;
     } else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to present swapchain images!");
     }
-    vkQueueWaitIdle(vulkanDevice->presentQueue);
+}
+
+void VulkanApplicationBase::updateLateLatchedUniforms() {}
+
+void VulkanApplicationBase::submitFrameCommands() {
+    FrameResources &frame = frames[currentFrame];
+    {
+        VulkanBase::FrameProfiler::CpuScope scope(profiler, VulkanBase::CpuPhase::UniformUpdate);
+        // Pick up input that arrived while the frame was being recorded
+        if (!headless) {
+            glfwPollEvents();
+        }
+        frame.inputSampleTime = std::chrono::steady_clock::now();
+        updateLateLatchedUniforms();
+    }
+    VulkanBase::FrameProfiler::CpuScope scope(profiler, VulkanBase::CpuPhase::Submit);
+    frameSubmission = frameDependencies;
+    frameSubmission.commandBuffers.assign(submitInfo.pCommandBuffers, submitInfo.pCommandBuffers + submitInfo.commandBufferCount);
+    for (uint32_t i = 0; i < submitInfo.waitSemaphoreCount; i++) {
+        frameSubmission.wait(submitInfo.pWaitSemaphores[i], submitInfo.pWaitDstStageMask[i]);
+    }
+    for (uint32_t i = 0; i < submitInfo.signalSemaphoreCount; i++) {
+        frameSubmission.signal(submitInfo.pSignalSemaphores[i]);
+    }
+    frame.submitValue = vulkanDevice->submit(vulkanDevice->graphicsQueue, frameSubmission);
+    if (!headless) {
+        imagesInFlight[currentBuffer] = frame.submitValue;
+    }
+    frameDependencies.clear();
+
+    auto it = pendingSwapchains.begin();
+    while (it != pendingSwapchains.end()) {
+        if (--it->framesLeft > 0) {
+            ++it;
+            continue;
+        }
+        VulkanBase::VulkanSwapchain *currentSwapchain = swapchain;
+        VulkanBase::RetiredSwapchain retired = it->swapchain;
+        vulkanDevice->retire([currentSwapchain, retired]() {
+            currentSwapchain->destroyRetired(retired);
+        });
+        it = pendingSwapchains.erase(it);
+    }
+}
+
+void VulkanApplicationBase::collectLatencySamples() {
+    // Too long for the small string buffer, building them every frame would allocate
+    static const std::string presentLatencyName = "Input to Present";
+    static const std::string gpuLatencyName = "Input to GPU complete";
+    // Polled once per frame, so a sample may end up to a frame later than the present or retirement it waits for
+    auto now = std::chrono::steady_clock::now();
+    size_t completed = 0;
+    for (; completed < latencySamples.size(); completed++) {
+        const LatencySample &sample = latencySamples[completed];
+        std::chrono::duration<double, std::milli> latency = now - sample.inputSampleTime;
+        if (sample.presentId != 0) {
+            VkResult result = swapchain->waitForPresent(sample.presentId, 0);
+            if (result == VK_TIMEOUT) {
+                break;
+            }
+            // An out of date swapchain never reports the present, its sample is dropped
+            if (result == VK_SUCCESS) {
+                profiler.addLatency(presentLatencyName, latency.count());
+            }
+        } else {
+            if (!vulkanDevice->isRetired(sample.submitValue)) {
+                break;
+            }
+            profiler.addLatency(gpuLatencyName, latency.count());
+        }
+    }
+    latencySamples.erase(latencySamples.begin(), latencySamples.begin() + completed);
+}
+
+void VulkanApplicationBase::waitBeforeFrame(VkSemaphore semaphore, VkPipelineStageFlags stage) {
+    frameDependencies.wait(semaphore, stage);
+}
+
+void VulkanApplicationBase::showPresentSettings() {
+    if (ImGui::CollapsingHeader("Present Settings")) {
+        const char *policies[] = {"Low Latency", "Power Saving", "VSync"};
+        int policy = static_cast<int>(presentPolicy);
+        if (ImGui::Combo("Present Policy", &policy, policies, IM_ARRAYSIZE(policies))) {
+            setPresentPolicy(static_cast<VulkanBase::PresentPolicy>(policy));
+        }
+        ImGui::SliderFloat("Frame Limit", &frameRateLimit, 0.0f, 240.0f, "%.0f fps");
+    }
+}
+
+void VulkanApplicationBase::waitForFrameDeadline() {
+    float limit = frameRateLimit;
+    if (limit <= 0.0f && presentPolicy == VulkanBase::PresentPolicy::PowerSaving) {
+        limit = powerSavingFrameRate;
+    }
+    if (limit <= 0.0f) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / limit));
+    // After a long stall restart the schedule instead of rendering a burst of frames to catch up
+    if (nextFrameDeadline + period < now) {
+        nextFrameDeadline = now;
+    } else if (nextFrameDeadline > now) {
+        std::this_thread::sleep_until(nextFrameDeadline);
+    }
+    nextFrameDeadline += period;
+}
+
+VkDeviceSize VulkanApplicationBase::getUniformRegionSize(VkDeviceSize size) const {
+    return VulkanBase::Tools::alignedVkSize(size, vulkanDevice->properties.limits.minUniformBufferOffsetAlignment);
 }
 
 int VulkanApplicationBase::getDeviceScore(const VkPhysicalDevice physicalDevice) {
@@ -317,9 +574,22 @@ int VulkanApplicationBase::getDeviceScore(const VkPhysicalDevice physicalDevice)
     VkPhysicalDeviceProperties properties;
     vkGetPhysicalDeviceProperties(physicalDevice, &properties);
     std::cout << "New Physical Device Found : " << properties.deviceName << std::endl;
-    if (properties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-        std::cout << properties.deviceName << "is not drawing GPUs." << std::endl;
-        return -1;
+    // Prefer real GPUs but keep software rasterizers such as lavapipe usable
+    switch (properties.deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            score = 1000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            score = 100;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            score = 50;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            score = 10;
+            break;
+        default:
+            break;
     }
     VkPhysicalDeviceFeatures features;
     vkGetPhysicalDeviceFeatures(physicalDevice, &features);
@@ -327,6 +597,11 @@ int VulkanApplicationBase::getDeviceScore(const VkPhysicalDevice physicalDevice)
         std::cout << properties.deviceName << "doesn't support anisotropy filtering." << std::endl;
         return -1;
     }
+    // Submission tracking relies on core timeline semaphores
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+        std::cout << properties.deviceName << " doesn't support Vulkan 1.2." << std::endl;
+        return -1;
+    }
     return score;
 }
 
@@ -360,6 +635,9 @@ VkPhysicalDevice VulkanApplicationBase::pickPhysicalDevice() {
 }
 
 std::vector<const char *> VulkanApplicationBase::getRequiredExtensions() {
+    if (headless) {
+        return {};
+    }
     uint32_t glfwExtensionCount = 0;
     const char **glfwExtensions;
     glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
@@ -399,7 +677,7 @@ void VulkanApplicationBase::createInstance() {
     appInfo.pEngineName = "Richelieu";
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = apiVersion;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -436,57 +714,110 @@ void VulkanApplicationBase::createInstance() {
         }
     }
 
-    if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
+    if (!headless && glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
         throw std::runtime_error("failed to create surface!");
     }
 }
 
 void VulkanApplicationBase::renderLoop() {
-    while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
-        drawFrame();
+    if (headless) {
+        for (uint32_t i = 0; i < headlessFrameCount; i++) {
+            drawFrame();
+        }
+        vkDeviceWaitIdle(vulkanDevice->logicalDevice);
+        for (uint32_t i = 0; i < offscreenTargets.size(); i++) {
+            writeOffscreenTarget(i);
+        }
+    } else {
+        while (!glfwWindowShouldClose(window)) {
+            // Sleep before polling so the frame starts from the freshest input
+            waitForFrameDeadline();
+            glfwPollEvents();
+            drawFrame();
+        }
+        vkDeviceWaitIdle(vulkanDevice->logicalDevice);
+    }
+    if (!profileOutputPrefix.empty()) {
+        profiler.exportCSV(profileOutputPrefix + ".csv");
+        profiler.exportJSON(profileOutputPrefix + ".json");
+        memoryReport.exportJSON(profileOutputPrefix + ".memory.json");
     }
-    vkDeviceWaitIdle(vulkanDevice->logicalDevice);
 }
 
 void VulkanApplicationBase::drawFrame() {}
 
 void VulkanApplicationBase::createCommandBuffers() {
-    drawCommandBuffers.resize(swapchain->imageCount);
+    frames.resize(maxFramesInFlight);
+    std::vector<VkCommandBuffer> commandBuffers(maxFramesInFlight);
+    std::vector<VkCommandBuffer> secondaryCommandBuffers(maxFramesInFlight * 2);
     VkCommandBufferAllocateInfo allocateInfo{};
     allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocateInfo.commandPool = cmdPool;
     allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocateInfo.commandBufferCount = static_cast<uint32_t>(drawCommandBuffers.size());
-    VK_CHECK_RESULT(vkAllocateCommandBuffers(vulkanDevice->logicalDevice, &allocateInfo, drawCommandBuffers.data()));
+    allocateInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(vulkanDevice->logicalDevice, &allocateInfo, commandBuffers.data()));
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocateInfo.commandBufferCount = static_cast<uint32_t>(secondaryCommandBuffers.size());
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(vulkanDevice->logicalDevice, &allocateInfo, secondaryCommandBuffers.data()));
+    for (uint32_t i = 0; i < maxFramesInFlight; i++) {
+        frames[i].commandBuffer = commandBuffers[i];
+        frames[i].staticCommandBuffer = secondaryCommandBuffers[i * 2];
+        frames[i].overlayCommandBuffer = secondaryCommandBuffers[i * 2 + 1];
+        frames[i].staticDirty = true;
+    }
+}
+
+void VulkanApplicationBase::createThreadCommandPools() {
+    if (recordingThreadCount == 0) {
+        recordingThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threadPool = new VulkanBase::ThreadPool(recordingThreadCount);
+    for (uint32_t i = 0; i < recordingThreadCount; i++) {
+        workerArenas.push_back(new VulkanBase::LinearArena());
+    }
+
+    VkCommandPoolCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    createInfo.queueFamilyIndex = vulkanDevice->queueIndices.graphicsIdx;
+    // Pools are reset as a whole once their frame slot has retired
+    createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    threadCommandPools.resize(maxFramesInFlight);
+    for (auto& framePools : threadCommandPools) {
+        framePools.resize(recordingThreadCount);
+        for (auto& threadPoolResources : framePools) {
+            VK_CHECK_RESULT(vkCreateCommandPool(vulkanDevice->logicalDevice, &createInfo, nullptr, &threadPoolResources.commandPool));
+        }
+    }
 }
 
 void VulkanApplicationBase::createSyncPrimitives() {
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    VK_CHECK_RESULT(vkCreateSemaphore(vulkanDevice->logicalDevice, &semaphoreInfo, nullptr, &semaphores.renderCompleteSemaphore));
-    VK_CHECK_RESULT(vkCreateSemaphore(vulkanDevice->logicalDevice, &semaphoreInfo, nullptr, &semaphores.presentCompleteSemaphore));
 
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    inFlightFences.resize(drawCommandBuffers.size());
-    for (auto& fence : inFlightFences) {
-        VK_CHECK_RESULT(vkCreateFence(vulkanDevice->logicalDevice, &fenceInfo, nullptr, &fence));
+    for (auto& frame : frames) {
+        VK_CHECK_RESULT(vkCreateSemaphore(vulkanDevice->logicalDevice, &semaphoreInfo, nullptr, &frame.presentCompleteSemaphore));
+        VK_CHECK_RESULT(vkCreateSemaphore(vulkanDevice->logicalDevice, &semaphoreInfo, nullptr, &frame.renderCompleteSemaphore));
     }
+    imagesInFlight.assign(imageCount, 0);
+
     submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.pWaitDstStageMask = &waitStages;
     submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &semaphores.presentCompleteSemaphore;
+    submitInfo.pWaitSemaphores = &frames[0].presentCompleteSemaphore;
     submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &semaphores.renderCompleteSemaphore;
+    submitInfo.pSignalSemaphores = &frames[0].renderCompleteSemaphore;
+    if (headless) {
+        // Nothing is acquired or presented, so the semaphores are never signaled
+        submitInfo.waitSemaphoreCount = 0;
+        submitInfo.signalSemaphoreCount = 0;
+    }
 }
 
 void VulkanApplicationBase::createCommandPool() {
     VkCommandPoolCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    createInfo.queueFamilyIndex = swapchain->queueIndices.graphicsIdx;
+    createInfo.queueFamilyIndex = vulkanDevice->queueIndices.graphicsIdx;
     createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
     VK_CHECK_RESULT(vkCreateCommandPool(vulkanDevice->logicalDevice, &createInfo, nullptr, &cmdPool));
 }
@@ -499,39 +830,199 @@ void VulkanApplicationBase::windowResize() {
         glfwGetFramebufferSize(window, &destWidth, &destHeight);
         glfwWaitEvents();
     }
-    vkDeviceWaitIdle(vulkanDevice->logicalDevice);
 
     width = destWidth;
     height = destHeight;
-    swapchain->createSwapchain(&width, &height);
+    // The old swapchain is handed over through oldSwapchain and kept alive for the frames still presenting from it.
+    // Presents carry no timeline value, so it is assumed they finish in queue order: once maxFramesInFlight frames were
+    // submitted on the new swapchain and retired, every present queued on the old one has completed too
+    VulkanBase::RetiredSwapchain oldSwapchain;
+    swapchain->createSwapchain(&width, &height, &oldSwapchain);
+    imageCount = swapchain->imageCount;
+    if (oldSwapchain.swapchain != VK_NULL_HANDLE) {
+        pendingSwapchains.push_back({oldSwapchain, maxFramesInFlight});
+    }
 
-    vkDestroyImageView(vulkanDevice->logicalDevice, depthStencil.imageView, nullptr);
-    vkDestroyImage(vulkanDevice->logicalDevice, depthStencil.image, nullptr);
-    vkFreeMemory(vulkanDevice->logicalDevice, depthStencil.memory, nullptr);
+    // Only size dependent attachments are rebuilt, in-flight frames keep rendering into the old ones
+    VkDevice device = vulkanDevice->logicalDevice;
+    VulkanBase::MemoryAllocator *allocator = vulkanDevice->allocator;
+    auto oldDepthStencil = depthStencil;
+    auto oldColorResources = colorResources;
+    std::vector<VkFramebuffer> oldFrameBuffers = frameBuffers;
+    vulkanDevice->retire([device, allocator, oldDepthStencil, oldColorResources, oldFrameBuffers]() mutable {
+        for (auto& frameBuffer : oldFrameBuffers) {
+            vkDestroyFramebuffer(device, frameBuffer, nullptr);
+        }
+        vkDestroyImageView(device, oldColorResources.imageView, nullptr);
+        vkDestroyImage(device, oldColorResources.image, nullptr);
+        allocator->free(oldColorResources.allocation);
+        vkDestroyImageView(device, oldDepthStencil.imageView, nullptr);
+        vkDestroyImage(device, oldDepthStencil.image, nullptr);
+        allocator->free(oldDepthStencil.allocation);
+    });
     setupDepthStencil();
-    for (auto& frameBuffer : frameBuffers) {
-        vkDestroyFramebuffer(vulkanDevice->logicalDevice, frameBuffer, nullptr);
-    }
+    setupColorResources();
     createFrameBuffer();
-    vkFreeCommandBuffers(vulkanDevice->logicalDevice, cmdPool, static_cast<uint32_t>(drawCommandBuffers.size()), drawCommandBuffers.data());
-    createCommandBuffers();
-    buildCommandBuffers();
+    // Frame slots are not tied to swapchain images, so their command buffers and semaphores survive the resize
+    imagesInFlight.assign(imageCount, 0);
+    // Present ids of the replaced swapchain can't be waited on through the new one
+    latencySamples.clear();
+    // Viewport and scissor are baked into the static scene
+    invalidateStaticCommandBuffers();
+}
 
-    for (auto& fence : inFlightFences) {
-        vkDestroyFence(vulkanDevice->logicalDevice, fence, nullptr);
+void VulkanApplicationBase::buildCommandBuffers() {
+    VulkanBase::FrameProfiler::CpuScope scope(profiler, VulkanBase::CpuPhase::Record);
+    FrameResources &frame = frames[currentFrame];
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+
+    VkCommandBufferBeginInfo secondaryBeginInfo{};
+    secondaryBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    // The static scene is shared by every swapchain image, so it cannot reference a framebuffer
+    if (frame.staticDirty) {
+        inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+        secondaryBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        VK_CHECK_RESULT(vkBeginCommandBuffer(frame.staticCommandBuffer, &secondaryBeginInfo));
+        buildStaticCommandBuffer(frame.staticCommandBuffer);
+        VK_CHECK_RESULT(vkEndCommandBuffer(frame.staticCommandBuffer));
+        frame.staticDirty = false;
     }
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    inFlightFences.resize(drawCommandBuffers.size());
-    for (auto& fence : inFlightFences) {
-        VK_CHECK_RESULT(vkCreateFence(vulkanDevice->logicalDevice, &fenceInfo, nullptr, &fence));
+
+    inheritanceInfo.framebuffer = frameBuffers[currentBuffer];
+    VulkanBase::ArenaVector<VkCommandBuffer> secondaryCommandBuffers{VulkanBase::ArenaAllocator<VkCommandBuffer>(frameArena())};
+    secondaryCommandBuffers.push_back(frame.staticCommandBuffer);
+    recordParallelCommandBuffers(inheritanceInfo, secondaryCommandBuffers);
+
+    secondaryBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(frame.overlayCommandBuffer, &secondaryBeginInfo));
+    buildOverlayCommandBuffer(frame.overlayCommandBuffer);
+    VK_CHECK_RESULT(vkEndCommandBuffer(frame.overlayCommandBuffer));
+    secondaryCommandBuffers.push_back(frame.overlayCommandBuffer);
+
+    VkCommandBufferBeginInfo bufferBeginInfo{};
+    bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    std::array<VkClearValue, 2> clearValues = {};
+    clearValues[0].color = defaultClearColor;
+    clearValues[1].depthStencil = {1.0f, 0};
+
+    VkRenderPassBeginInfo renderPassBeginInfo{};
+    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassBeginInfo.renderPass = renderPass;
+    renderPassBeginInfo.renderArea.offset = {0, 0};
+    renderPassBeginInfo.renderArea.extent = {width, height};
+    renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassBeginInfo.pClearValues = clearValues.data();
+    renderPassBeginInfo.framebuffer = frameBuffers[currentBuffer];
+
+    VK_CHECK_RESULT(vkBeginCommandBuffer(frame.commandBuffer, &bufferBeginInfo));
+    profiler.resetQueries(frame.commandBuffer, currentFrame);
+    // Timestamps can't be written inside a render pass that only executes secondaries
+    profiler.beginGpuScope(frame.commandBuffer, currentFrame, "Main Pass");
+    vkCmdBeginRenderPass(frame.commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    vkCmdExecuteCommands(frame.commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+    vkCmdEndRenderPass(frame.commandBuffer);
+    profiler.endGpuScope(frame.commandBuffer, currentFrame);
+    if (headless) {
+        OffscreenTarget &target = offscreenTargets[currentBuffer];
+        VkBufferImageCopy copyRegion{};
+        copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copyRegion.imageSubresource.layerCount = 1;
+        copyRegion.imageExtent = {width, height, 1};
+        vkCmdCopyImageToBuffer(frame.commandBuffer, target.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target.readbackBuffer, 1, &copyRegion);
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = target.readbackBuffer;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(frame.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
     }
+    VK_CHECK_RESULT(vkEndCommandBuffer(frame.commandBuffer));
+}
 
-    vkDeviceWaitIdle(vulkanDevice->logicalDevice);
+void VulkanApplicationBase::recordParallelCommandBuffers(VkCommandBufferInheritanceInfo inheritanceInfo,
+                                                         VulkanBase::ArenaVector<VkCommandBuffer> &commandBuffers) {
+    uint32_t drawCount = getParallelDrawCount();
+    if (drawCount == 0) {
+        return;
+    }
+    std::vector<ThreadCommandPool>& framePools = threadCommandPools[currentFrame];
+    // prepareFrame() waited for frame.submitValue, so nothing recorded from these pools is still pending
+    for (auto& pool : framePools) {
+        VK_CHECK_RESULT(vkResetCommandPool(vulkanDevice->logicalDevice, pool.commandPool, 0));
+        pool.usedCount = 0;
+    }
+
+    uint32_t taskCount = std::min(threadPool->size(), (drawCount + minDrawsPerTask - 1) / minDrawsPerTask);
+    uint32_t drawsPerTask = (drawCount + taskCount - 1) / taskCount;
+    VulkanBase::ArenaVector<VkCommandBuffer> taskCommandBuffers(taskCount, VK_NULL_HANDLE, VulkanBase::ArenaAllocator<VkCommandBuffer>(frameArena()));
+    threadPool->parallelFor(taskCount, [&](uint32_t taskIndex, uint32_t threadIndex) {
+        VulkanBase::ArenaScope scratch(*workerArenas[threadIndex]);
+        ThreadCommandPool& pool = framePools[threadIndex];
+        if (pool.usedCount == pool.commandBuffers.size()) {
+            VkCommandBufferAllocateInfo allocateInfo{};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.commandPool = pool.commandPool;
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocateInfo.commandBufferCount = 1;
+            VkCommandBuffer cmdBuffer;
+            VK_CHECK_RESULT(vkAllocateCommandBuffers(vulkanDevice->logicalDevice, &allocateInfo, &cmdBuffer));
+            pool.commandBuffers.push_back(cmdBuffer);
+        }
+        VkCommandBuffer cmdBuffer = pool.commandBuffers[pool.usedCount++];
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &beginInfo));
+        uint32_t firstDraw = taskIndex * drawsPerTask;
+        if (firstDraw < drawCount) {
+            buildParallelCommandBuffer(cmdBuffer, firstDraw, std::min(drawsPerTask, drawCount - firstDraw), threadIndex);
+        }
+        VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+        taskCommandBuffers[taskIndex] = cmdBuffer;
+    });
+    // Keep submission order stable regardless of which worker finished first
+    commandBuffers.insert(commandBuffers.end(), taskCommandBuffers.begin(), taskCommandBuffers.end());
+}
+
+uint32_t VulkanApplicationBase::getParallelDrawCount() {
+    return 0;
+}
+
+void VulkanApplicationBase::buildParallelCommandBuffer(VkCommandBuffer cmdBuffer, uint32_t firstDraw, uint32_t drawCount, uint32_t threadIndex) {}
+
+void VulkanApplicationBase::buildStaticCommandBuffer(VkCommandBuffer cmdBuffer) {}
+
+void VulkanApplicationBase::buildOverlayCommandBuffer(VkCommandBuffer cmdBuffer) {
+    // ImGui is bound to the GLFW window
+    if (!headless) {
+        showGUIWindow(cmdBuffer);
+    }
 }
 
-void VulkanApplicationBase::buildCommandBuffers() {}
+VulkanBase::LinearArena &VulkanApplicationBase::frameArena() {
+    return *frameArenas[currentFrame];
+}
+
+void VulkanApplicationBase::invalidateStaticCommandBuffers() {
+    // Slots are re-recorded lazily the next time they are used
+    for (auto& frame : frames) {
+        frame.staticDirty = true;
+    }
+}
 
 VkResult VulkanApplicationBase::createDebugUtilsMessengerExt(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT *pCreateInfo,
                                                              const VkAllocationCallbacks *pAllocator,
@@ -554,10 +1045,24 @@ void VulkanApplicationBase::DestroyDebugUtilsMessengerEXT(VkInstance instance, V
 }
 
 VulkanApplicationBase::~VulkanApplicationBase() {
-    vkDestroyDescriptorPool(vulkanDevice->logicalDevice, imGuiDescriptorPool, nullptr);
+    if (!headless) {
+        ImGui_ImplVulkan_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+        vkDestroyDescriptorPool(vulkanDevice->logicalDevice, imGuiDescriptorPool, nullptr);
+    }
 
+    // Retired swapchains still need the live one to be destroyed
+    for (auto &pending : pendingSwapchains) {
+        swapchain->destroyRetired(pending.swapchain);
+    }
+    vulkanDevice->collectRetired(true);
     delete(swapchain);
-    vkFreeCommandBuffers(vulkanDevice->logicalDevice, cmdPool, static_cast<uint32_t>(drawCommandBuffers.size()), drawCommandBuffers.data());
+    destroyOffscreenTargets();
+    for (auto& frame : frames) {
+        std::array<VkCommandBuffer, 3> commandBuffers = {frame.commandBuffer, frame.staticCommandBuffer, frame.overlayCommandBuffer};
+        vkFreeCommandBuffers(vulkanDevice->logicalDevice, cmdPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+    }
     vkDestroyRenderPass(vulkanDevice->logicalDevice, renderPass, nullptr);
     for (auto& frameBuffer : frameBuffers) {
         vkDestroyFramebuffer(vulkanDevice->logicalDevice, frameBuffer, nullptr);
@@ -567,26 +1072,45 @@ VulkanApplicationBase::~VulkanApplicationBase() {
     }
     vkDestroyImageView(vulkanDevice->logicalDevice, colorResources.imageView, nullptr);
     vkDestroyImage(vulkanDevice->logicalDevice, colorResources.image, nullptr);
-    vkFreeMemory(vulkanDevice->logicalDevice, colorResources.memory, nullptr);
+    vulkanDevice->allocator->free(colorResources.allocation);
     vkDestroyImageView(vulkanDevice->logicalDevice, depthStencil.imageView, nullptr);
     vkDestroyImage(vulkanDevice->logicalDevice, depthStencil.image, nullptr);
-    vkFreeMemory(vulkanDevice->logicalDevice, depthStencil.memory, nullptr);
+    vulkanDevice->allocator->free(depthStencil.allocation);
 
     vkDestroyPipelineCache(vulkanDevice->logicalDevice, pipelineCache, nullptr);
 
     vkDestroyCommandPool(vulkanDevice->logicalDevice, cmdPool, nullptr);
-    vkDestroySemaphore(vulkanDevice->logicalDevice, semaphores.renderCompleteSemaphore, nullptr);
-    vkDestroySemaphore(vulkanDevice->logicalDevice, semaphores.presentCompleteSemaphore, nullptr);
-    for (auto& fence : inFlightFences) vkDestroyFence(vulkanDevice->logicalDevice, fence, nullptr);
+    delete(threadPool);
+    for (auto arena : workerArenas) {
+        delete(arena);
+    }
+    for (auto arena : frameArenas) {
+        delete(arena);
+    }
+    for (auto& framePools : threadCommandPools) {
+        for (auto& pool : framePools) {
+            vkDestroyCommandPool(vulkanDevice->logicalDevice, pool.commandPool, nullptr);
+        }
+    }
+    profiler.destroy();
+    delete(uniformAllocator);
+    for (auto& frame : frames) {
+        vkDestroySemaphore(vulkanDevice->logicalDevice, frame.renderCompleteSemaphore, nullptr);
+        vkDestroySemaphore(vulkanDevice->logicalDevice, frame.presentCompleteSemaphore, nullptr);
+    }
     delete(vulkanDevice);
     if (enableValidation) {
         DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
     }
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    if (surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(instance, surface, nullptr);
+    }
     vkDestroyInstance(instance, nullptr);
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (window != nullptr) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 }
 
 void VulkanApplicationBase::createPipelineCache() {
@@ -639,7 +1163,7 @@ void VulkanApplicationBase::createImGuiComponent() {
     initInfo.DescriptorPool = imGuiDescriptorPool;
     initInfo.Subpass = 0;
     initInfo.MinImageCount = 2;
-    initInfo.ImageCount = swapchain->imageCount;
+    initInfo.ImageCount = imageCount;
     initInfo.MSAASamples = vulkanDevice->msaaSamples;
     initInfo.Allocator = nullptr;
     initInfo.CheckVkResultFn = checkResult;
@@ -647,3 +1171,66 @@ void VulkanApplicationBase::createImGuiComponent() {
 
     vkDeviceWaitIdle(vulkanDevice->logicalDevice);
 }
+
+void VulkanApplicationBase::createOffscreenTargets() {
+    // RGBA byte order matches the PPM output, sRGB keeps it identical to the presented image
+    colorFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    imageCount = maxFramesInFlight;
+    offscreenTargets.resize(imageCount);
+    for (auto& target : offscreenTargets) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {width, height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = colorFormat;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VK_CHECK_RESULT(vkCreateImage(vulkanDevice->logicalDevice, &imageInfo, nullptr, &target.image));
+        target.allocation = vulkanDevice->allocator->allocateImage(target.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false,
+                                                                   VulkanBase::MemoryCategory::RenderTarget);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = target.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = colorFormat;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+        VK_CHECK_RESULT(vkCreateImageView(vulkanDevice->logicalDevice, &viewInfo, nullptr, &target.imageView));
+
+        VkDeviceSize readbackSize = (VkDeviceSize)width * height * 4;
+        vulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                   &target.readbackBuffer, &target.readbackAllocation, readbackSize);
+        target.pendingFrame = -1;
+    }
+}
+
+void VulkanApplicationBase::destroyOffscreenTargets() {
+    for (auto& target : offscreenTargets) {
+        vkDestroyBuffer(vulkanDevice->logicalDevice, target.readbackBuffer, nullptr);
+        vulkanDevice->allocator->free(target.readbackAllocation);
+        vkDestroyImageView(vulkanDevice->logicalDevice, target.imageView, nullptr);
+        vkDestroyImage(vulkanDevice->logicalDevice, target.image, nullptr);
+        vulkanDevice->allocator->free(target.allocation);
+    }
+    offscreenTargets.clear();
+}
+
+void VulkanApplicationBase::writeOffscreenTarget(uint32_t index) {
+    OffscreenTarget &target = offscreenTargets[index];
+    if (target.pendingFrame < 0) {
+        return;
+    }
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "_%05lld.ppm", static_cast<long long>(target.pendingFrame));
+    VulkanBase::Tools::writePPM(headlessOutputPrefix + fileName, static_cast<const unsigned char *>(target.readbackAllocation.mapped), width, height);
+    target.pendingFrame = -1;
+}
@@ -1,26 +1,23 @@
 #include "VulkanBuffer.h"
+#include "VulkanDevice.h"
 #include <iostream>
 #include <cassert>
 #include <stdexcept>
 
 void VulkanBase::VulkanBuffer::map(VkDeviceSize deviceSize, VkDeviceSize offset) {
-    VK_CHECK_RESULT(vkMapMemory(logicalDevice, memory, offset, deviceSize, 0, &mapped));
+    // Host visible allocations stay mapped for their whole lifetime
+    if (allocation.mapped == nullptr) {
+        throw std::runtime_error("buffer memory is not host visible!");
+    }
+    mapped = static_cast<char *>(allocation.mapped) + offset;
 }
 
 void VulkanBase::VulkanBuffer::unmap() {
-    if (mapped) {
-        vkUnmapMemory(logicalDevice, memory);
-        mapped = nullptr;
-    }
+    mapped = nullptr;
 }
 
 void VulkanBase::VulkanBuffer::flush(VkDeviceSize deviceSize, VkDeviceSize offset) const {
-    VkMappedMemoryRange mappedRange{};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = memory;
-    mappedRange.offset = offset;
-    mappedRange.size = deviceSize;
-    VK_CHECK_RESULT(vkFlushMappedMemoryRanges(logicalDevice, 1, &mappedRange));
+    allocator->flush(allocation, offset, deviceSize);
 }
 
 void VulkanBase::VulkanBuffer::setDescriptor(VkDeviceSize deviceSize, VkDeviceSize offset) {
@@ -29,12 +26,21 @@ void VulkanBase::VulkanBuffer::setDescriptor(VkDeviceSize deviceSize, VkDeviceSi
     bufferInfo.buffer = buffer;
 }
 
-void VulkanBase::VulkanBuffer::bind(VkDeviceSize offset) const {
-    VK_CHECK_RESULT(vkBindBufferMemory(logicalDevice, buffer, memory, offset));
-}
-
 void VulkanBase::VulkanBuffer::cleanUp() {
     vkDestroyBuffer(logicalDevice, buffer, nullptr);
-    vkFreeMemory(logicalDevice, memory, nullptr);
+    allocator->free(allocation);
 }
 
+void VulkanBase::VulkanBuffer::retire() {
+    VkDevice logicalDevice = this->logicalDevice;
+    MemoryAllocator *allocator = this->allocator;
+    VkBuffer buffer = this->buffer;
+    Allocation allocation = this->allocation;
+    device->retire([logicalDevice, allocator, buffer, allocation]() mutable {
+        vkDestroyBuffer(logicalDevice, buffer, nullptr);
+        allocator->free(allocation);
+    });
+    this->buffer = VK_NULL_HANDLE;
+    this->allocation = Allocation();
+    mapped = nullptr;
+}
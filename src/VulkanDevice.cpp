@@ -1,9 +1,27 @@
 #include "VulkanDevice.h"
+#include "VulkanGeometryPool.h"
 #include "VulkanApplicationBase.h"
 
 #include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 
 namespace VulkanBase {
+    // Buffers only need their usage to be sorted into a report category
+    static MemoryCategory bufferCategory(VkBufferUsageFlags usageFlags) {
+        if (usageFlags & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) {
+            return MemoryCategory::Mesh;
+        }
+        if (usageFlags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+            return MemoryCategory::Uniform;
+        }
+        if ((usageFlags & ~(VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)) == 0) {
+            return MemoryCategory::Staging;
+        }
+        return MemoryCategory::Other;
+    }
+
     VulkanDevice::VulkanDevice(VkPhysicalDevice physDevice, VkSurfaceKHR surface) : physicalDevice(physDevice){
         vkGetPhysicalDeviceProperties(physicalDevice, &properties);
         VkSampleCountFlags counts = properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
@@ -23,6 +41,8 @@ namespace VulkanBase {
 
         queueIndices.graphicsIdx = -1;
         queueIndices.presentIdx = -1;
+        queueIndices.transferIdx = -1;
+        queueIndices.computeIdx = -1;
         uint32_t queueFamilyCount = 0;
         vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
         queueFamilyProperties.resize(queueFamilyCount);
@@ -34,7 +54,12 @@ namespace VulkanBase {
                 queueIndices.graphicsIdx = i;
             }
             VkBool32 presentSupport = VK_FALSE;
-            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+            if (surface != VK_NULL_HANDLE) {
+                vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+            } else if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                // Headless rendering never presents, the graphics queue stands in for the present queue
+                presentSupport = VK_TRUE;
+            }
             if (presentSupport == VK_TRUE) {
                 queueIndices.presentIdx = i;
                 break;
@@ -42,36 +67,125 @@ namespace VulkanBase {
             i++;
         }
 
+        // A family without graphics or compute is usually a dedicated DMA engine
+        queueIndices.transferIdx = queueIndices.graphicsIdx;
+        for (uint32_t family = 0; family < queueFamilyProperties.size(); family++) {
+            const VkQueueFamilyProperties &properties = queueFamilyProperties[family];
+            const VkExtent3D &granularity = properties.minImageTransferGranularity;
+            if ((properties.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(properties.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+                && granularity.width == 1 && granularity.height == 1 && granularity.depth == 1) {
+                queueIndices.transferIdx = family;
+                break;
+            }
+        }
+        // Work on a compute-only family runs alongside rasterization instead of behind it
+        queueIndices.computeIdx = queueIndices.graphicsIdx;
+        for (uint32_t family = 0; family < queueFamilyProperties.size(); family++) {
+            const VkQueueFlags flags = queueFamilyProperties[family].queueFlags;
+            if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+                queueIndices.computeIdx = family;
+                break;
+            }
+        }
+
         createLogicalDevice();
+        allocator = new MemoryAllocator(physicalDevice, logicalDevice);
+        stagingRing = new StagingRing(logicalDevice, allocator);
         vkGetDeviceQueue(logicalDevice, queueIndices.graphicsIdx, 0, &graphicsQueue);
         vkGetDeviceQueue(logicalDevice, queueIndices.presentIdx, 0, &presentQueue);
+        vkGetDeviceQueue(logicalDevice, queueIndices.transferIdx, 0, &transferQueue);
+        vkGetDeviceQueue(logicalDevice, queueIndices.computeIdx, 0, &computeQueue);
+        createTimelines();
     }
 
     void VulkanDevice::createLogicalDevice() {
         float queuePriority = 1.0f;
-        VkDeviceQueueCreateInfo queueCreateInfos[2] = {};
-        queueCreateInfos[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfos[0].queueFamilyIndex = queueIndices.graphicsIdx;
-        queueCreateInfos[0].queueCount = 1;
-        queueCreateInfos[0].pQueuePriorities = &queuePriority;
-        queueCreateInfos[1].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfos[1].queueFamilyIndex = queueIndices.presentIdx;
-        queueCreateInfos[1].queueCount = 1;
-        queueCreateInfos[1].pQueuePriorities = &queuePriority;
+        std::vector<uint32_t> families = {queueIndices.graphicsIdx, queueIndices.presentIdx, queueIndices.transferIdx, queueIndices.computeIdx};
+        std::sort(families.begin(), families.end());
+        families.erase(std::unique(families.begin(), families.end()), families.end());
+        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos(families.size());
+        for (size_t i = 0; i < families.size(); i++) {
+            queueCreateInfos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queueCreateInfos[i].queueFamilyIndex = families[i];
+            queueCreateInfos[i].queueCount = 1;
+            queueCreateInfos[i].pQueuePriorities = &queuePriority;
+        }
+
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+        presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+        presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        presentIdFeatures.pNext = &presentWaitFeatures;
+        bool swapchainEnabled = std::any_of(deviceExtensions.begin(), deviceExtensions.end(), [](const char *extension) {
+            return strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0;
+        });
+        if (swapchainEnabled && extensionSupported(VK_KHR_PRESENT_ID_EXTENSION_NAME) && extensionSupported(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+            timelineFeatures.pNext = &presentIdFeatures;
+        }
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &timelineFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+        if (!timelineFeatures.timelineSemaphore) {
+            throw std::runtime_error("timeline semaphores are not supported!");
+        }
+        presentWaitSupported = timelineFeatures.pNext != nullptr && presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+        if (!presentWaitSupported) {
+            timelineFeatures.pNext = nullptr;
+        }
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        createInfo.pQueueCreateInfos = queueCreateInfos;
-        createInfo.queueCreateInfoCount = queueIndices.graphicsIdx != queueIndices.presentIdx ? 2 : 1;
+        createInfo.pNext = &timelineFeatures;
+        createInfo.pQueueCreateInfos = queueCreateInfos.data();
+        createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         features.samplerAnisotropy = VK_TRUE;
         createInfo.pEnabledFeatures = &features;
         createInfo.enabledLayerCount = enableValidation ? static_cast<uint32_t>(validationLayers.size()) : 0;
         createInfo.ppEnabledLayerNames = enableValidation ? validationLayers.data() : nullptr;
-        createInfo.enabledExtensionCount = deviceExtensions.size();
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        std::vector<const char *> enabledExtensions = deviceExtensions;
+        if (extensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+            enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            memoryBudgetSupported = true;
+        }
+        if (presentWaitSupported) {
+            enabledExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+            enabledExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        }
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
         VK_CHECK_RESULT(vkCreateDevice(physicalDevice, &createInfo, nullptr, &logicalDevice));
 
         commandPool = createCommandPool(queueIndices.graphicsIdx);
+        graphicsOneShotPool = new OneShotCommandPool(logicalDevice, queueIndices.graphicsIdx);
+        transferOneShotPool = new OneShotCommandPool(logicalDevice, queueIndices.transferIdx);
+        computeCommandPool = createCommandPool(queueIndices.computeIdx);
+    }
+
+    void VulkanDevice::createTimelines() {
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+        VkSemaphoreCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        createInfo.pNext = &typeInfo;
+        // Queues of a shared family are the same VkQueue and share a timeline
+        for (VkQueue queue : {graphicsQueue, presentQueue, transferQueue, computeQueue}) {
+            bool known = false;
+            for (const auto &timeline : timelines) {
+                known = known || timeline.queue == queue;
+            }
+            if (known) {
+                continue;
+            }
+            assert(timelines.size() < MAX_TIMELINES);
+            QueueTimeline timeline{queue, VK_NULL_HANDLE, 0, 0};
+            VK_CHECK_RESULT(vkCreateSemaphore(logicalDevice, &createInfo, nullptr, &timeline.semaphore));
+            timelines.push_back(timeline);
+        }
     }
 
     uint32_t VulkanDevice::getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties,
@@ -96,6 +210,17 @@ namespace VulkanBase {
     }
 
     VulkanDevice::~VulkanDevice() {
+        collectUploads(true);
+        collectRetired(true);
+        delete geometryPool;
+        delete stagingRing;
+        delete allocator;
+        delete graphicsOneShotPool;
+        delete transferOneShotPool;
+        for (auto &timeline : timelines) {
+            vkDestroySemaphore(logicalDevice, timeline.semaphore, nullptr);
+        }
+        vkDestroyCommandPool(logicalDevice, computeCommandPool, nullptr);
         vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
         vkDestroyDevice(logicalDevice, nullptr);
     }
@@ -122,19 +247,11 @@ namespace VulkanBase {
         VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &createInfo, nullptr, &pBuffer->buffer));
 
         VkMemoryRequirements memoryRequirements;
-        VkMemoryAllocateInfo allocateInfo{};
-        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
         vkGetBufferMemoryRequirements(logicalDevice, pBuffer->buffer, &memoryRequirements);
-        allocateInfo.allocationSize = memoryRequirements.size;
-        allocateInfo.memoryTypeIndex = getMemoryType(memoryRequirements.memoryTypeBits, propertyFlags);
-
-        VkMemoryAllocateFlagsInfoKHR flagsInfo{};
-        if (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
-            flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR;
-            flagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
-            allocateInfo.pNext = &flagsInfo;
-        }
-        VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &allocateInfo, nullptr, &pBuffer->memory));
+        pBuffer->allocator = allocator;
+        pBuffer->device = this;
+        pBuffer->allocation = allocator->allocateBuffer(pBuffer->buffer, propertyFlags, (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0,
+                                                        bufferCategory(usageFlags));
 
         pBuffer->alignment = memoryRequirements.alignment;
         pBuffer->size = size;
@@ -150,7 +267,6 @@ namespace VulkanBase {
             pBuffer->unmap();
         }
         pBuffer->setDescriptor();
-        pBuffer->bind();
     }
 
     void VulkanDevice::copyBuffer(VulkanBuffer *src, VulkanBuffer *dest, VkQueue queue, VkBufferCopy *copyRegion) {
@@ -170,14 +286,18 @@ namespace VulkanBase {
         flushCommandBuffer(copyCommand, queue, true);
     }
 
-    VkCommandBuffer VulkanDevice::createCommandBuffer(VkCommandBufferLevel level, bool begin) {
-        VkCommandBufferAllocateInfo allocateInfo{};
-        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocateInfo.commandPool = commandPool;
-        allocateInfo.level = level;
-        allocateInfo.commandBufferCount = 1;
+    VkCommandBuffer VulkanDevice::createCommandBuffer(VkCommandBufferLevel level, bool begin, VkCommandPool pool) {
         VkCommandBuffer copyCommand;
-        VK_CHECK_RESULT(vkAllocateCommandBuffers(logicalDevice, &allocateInfo, &copyCommand));
+        if (pool == VK_NULL_HANDLE && level == VK_COMMAND_BUFFER_LEVEL_PRIMARY) {
+            copyCommand = graphicsOneShotPool->acquire();
+        } else {
+            VkCommandBufferAllocateInfo allocateInfo{};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.commandPool = pool != VK_NULL_HANDLE ? pool : commandPool;
+            allocateInfo.level = level;
+            allocateInfo.commandBufferCount = 1;
+            VK_CHECK_RESULT(vkAllocateCommandBuffers(logicalDevice, &allocateInfo, &copyCommand));
+        }
         if (begin) {
             VkCommandBufferBeginInfo beginInfo{};
             beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -186,65 +306,365 @@ namespace VulkanBase {
         return copyCommand;
     }
 
-    void VulkanDevice::flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free) const {
+    void VulkanDevice::flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free, VkCommandPool pool) {
         VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+        QueueSubmission submission;
+        submission.commandBuffers.push_back(commandBuffer);
+        // ensure that the command buffer has finished executing
+        waitRetired(submit(queue, submission));
+        if (!free) {
+            return;
+        }
+        if (pool == VK_NULL_HANDLE && graphicsOneShotPool->owns(commandBuffer)) {
+            graphicsOneShotPool->recycle(commandBuffer);
+        } else {
+            vkFreeCommandBuffers(logicalDevice, pool != VK_NULL_HANDLE ? pool : commandPool, 1, &commandBuffer);
+        }
+    }
+
+    uint64_t VulkanDevice::submit(VkQueue queue, const QueueSubmission &submission) {
+        assert(submission.waitSemaphores.size() == submission.waitStages.size());
+        assert(submission.waitSemaphores.size() == submission.waitValues.size());
+        QueueTimeline &timeline = getTimeline(queue);
+        uint64_t value = (++submissionCount << TIMELINE_INDEX_BITS) | static_cast<uint64_t>(&timeline - timelines.data());
+
+        ArenaScope scratch(scratchArena);
+        ArenaVector<VkSemaphore> signalSemaphores(submission.signalSemaphores.begin(), submission.signalSemaphores.end(),
+                                                  ArenaAllocator<VkSemaphore>(scratchArena));
+        ArenaVector<uint64_t> signalValues(signalSemaphores.size(), 0, ArenaAllocator<uint64_t>(scratchArena));
+        signalSemaphores.push_back(timeline.semaphore);
+        signalValues.push_back(value);
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(submission.waitValues.size());
+        timelineInfo.pWaitSemaphoreValues = submission.waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
-        // ensure that the command buffer has finished executing
-        VkFence fence;
-        VkFenceCreateInfo fenceInfo{};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = 0;
-        VK_CHECK_RESULT(vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fence));
-        VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, fence));
-        VK_CHECK_RESULT(vkWaitForFences(logicalDevice, 1, &fence, VK_TRUE, UINT64_MAX));
-        vkDestroyFence(logicalDevice, fence, nullptr);
-        if (free) {
-            vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(submission.waitSemaphores.size());
+        submitInfo.pWaitSemaphores = submission.waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = submission.waitStages.data();
+        submitInfo.commandBufferCount = static_cast<uint32_t>(submission.commandBuffers.size());
+        submitInfo.pCommandBuffers = submission.commandBuffers.data();
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+        VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+        timeline.lastSubmitted = value;
+        return value;
+    }
+
+    VkSemaphore VulkanDevice::getTimelineSemaphore(VkQueue queue) const {
+        for (const auto &timeline : timelines) {
+            if (timeline.queue == queue) {
+                return timeline.semaphore;
+            }
+        }
+        throw std::runtime_error("queue has no timeline semaphore!");
+    }
+
+    VulkanDevice::QueueTimeline &VulkanDevice::getTimeline(VkQueue queue) {
+        for (auto &timeline : timelines) {
+            if (timeline.queue == queue) {
+                return timeline;
+            }
+        }
+        throw std::runtime_error("queue has no timeline semaphore!");
+    }
+
+    VulkanDevice::QueueTimeline &VulkanDevice::getTimeline(uint64_t value) {
+        return timelines[value & (MAX_TIMELINES - 1)];
+    }
+
+    bool VulkanDevice::isRetired(QueueTimeline &timeline, uint64_t value) {
+        if (timeline.completed < value) {
+            VK_CHECK_RESULT(vkGetSemaphoreCounterValue(logicalDevice, timeline.semaphore, &timeline.completed));
         }
+        return timeline.completed >= value;
+    }
+
+    bool VulkanDevice::isRetired(uint64_t value) {
+        return value == 0 || isRetired(getTimeline(value), value);
+    }
+
+    void VulkanDevice::waitRetired(uint64_t value) {
+        if (value == 0) {
+            return;
+        }
+        QueueTimeline &timeline = getTimeline(value);
+        if (timeline.completed >= value) {
+            return;
+        }
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &timeline.semaphore;
+        waitInfo.pValues = &value;
+        VK_CHECK_RESULT(vkWaitSemaphores(logicalDevice, &waitInfo, UINT64_MAX));
+        timeline.completed = value;
+    }
+
+    VkSemaphore VulkanDevice::createSemaphore() const {
+        VkSemaphoreCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        VkSemaphore semaphore;
+        VK_CHECK_RESULT(vkCreateSemaphore(logicalDevice, &createInfo, nullptr, &semaphore));
+        return semaphore;
     }
 
-    void VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer *buffer, VkDeviceMemory *memory, VkDeviceSize size, void *data) {
+    bool VulkanDevice::hasDedicatedComputeQueue() const {
+        return queueIndices.computeIdx != queueIndices.graphicsIdx;
+    }
+
+    void VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer *buffer, Allocation *allocation, VkDeviceSize size, void *data) {
         VkBufferCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         createInfo.size = size;
         createInfo.usage = usageFlags;
 
         VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &createInfo, nullptr, buffer));
+        *allocation = allocator->allocateBuffer(*buffer, propertyFlags, (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0,
+                                                bufferCategory(usageFlags));
 
-        VkMemoryRequirements memoryRequirements;
-        VkMemoryAllocateInfo allocateInfo{};
-        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        vkGetBufferMemoryRequirements(logicalDevice, *buffer, &memoryRequirements);
-        allocateInfo.allocationSize = memoryRequirements.size;
-        allocateInfo.memoryTypeIndex = getMemoryType(memoryRequirements.memoryTypeBits, propertyFlags);
+        if (data != nullptr) {
+            memcpy(allocation->mapped, data, size);
+            // If host coherency hasn't been requested, do a manual flush to make writes visible
+            allocator->flush(*allocation, 0, size);
+        }
+    }
+
+    bool VulkanDevice::hasDedicatedTransferQueue() const {
+        return queueIndices.transferIdx != queueIndices.graphicsIdx;
+    }
+
+    bool VulkanDevice::extensionSupported(const char *extensionName) const {
+        for (const auto &extension : extensionProperties) {
+            if (strcmp(extension.extensionName, extensionName) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t VulkanDevice::getMemoryBudget(std::array<HeapBudget, VK_MAX_MEMORY_HEAPS> &heaps) const {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        if (memoryBudgetSupported) {
+            properties2.pNext = &budgetProperties;
+            vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties2);
+        }
 
-        VkMemoryAllocateFlagsInfoKHR flagsInfo{};
-        if (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
-            flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR;
-            flagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
-            allocateInfo.pNext = &flagsInfo;
+        MemoryStatistics statistics = allocator->getStatistics();
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            heaps[i].size = memoryProperties.memoryHeaps[i].size;
+            heaps[i].flags = memoryProperties.memoryHeaps[i].flags;
+            // The driver's usage also covers other processes and allocations made outside the allocator
+            heaps[i].budget = memoryBudgetSupported ? budgetProperties.heapBudget[i] : heaps[i].size;
+            heaps[i].usage = memoryBudgetSupported ? budgetProperties.heapUsage[i] : statistics.heapReservedBytes[i];
         }
-        VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &allocateInfo, nullptr, memory));
+        return memoryProperties.memoryHeapCount;
+    }
+
+    AsyncUpload *VulkanDevice::beginUpload() {
+        AsyncUpload *upload = new AsyncUpload();
+        upload->commandBuffer = transferOneShotPool->acquire();
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK_RESULT(vkBeginCommandBuffer(upload->commandBuffer, &beginInfo));
+        return upload;
+    }
 
+    StagingRegion VulkanDevice::stage(AsyncUpload *upload, const void *data, VkDeviceSize size, VkDeviceSize alignment) {
+        alignment = std::max(alignment, properties.limits.optimalBufferCopyOffsetAlignment);
+        StagingRegion region;
+        reclaimStaging();
+        while (!stagingRing->allocate(size, alignment, upload, region)) {
+            uint64_t oldest = stagingRing->oldestValue();
+            if (oldest == 0) {
+                // Too large for the ring, or the ring is held by uploads still being recorded
+                VkBuffer buffer;
+                Allocation allocation;
+                createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                             &buffer, &allocation, size);
+                region.buffer = buffer;
+                region.offset = 0;
+                region.size = size;
+                region.mapped = allocation.mapped;
+                VkDevice device = logicalDevice;
+                MemoryAllocator *memoryAllocator = allocator;
+                upload->onComplete.push_back([device, memoryAllocator, buffer, allocation]() mutable {
+                    vkDestroyBuffer(device, buffer, nullptr);
+                    memoryAllocator->free(allocation);
+                });
+                break;
+            }
+            waitRetired(oldest);
+            stagingRing->releaseOldest();
+        }
         if (data != nullptr) {
-            void *mapped;
-            VK_CHECK_RESULT(vkMapMemory(logicalDevice, *memory, 0, size, 0, &mapped));
-            memcpy(mapped, data, size);
-            // If host coherency hasn't been requested, do a manual flush to make writes visible
-            if ((propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
-            {
-                VkMappedMemoryRange mappedRange{};
-                mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-                mappedRange.memory = *memory;
-                mappedRange.offset = 0;
-                mappedRange.size = size;
-                vkFlushMappedMemoryRanges(logicalDevice, 1, &mappedRange);
-            }
-            vkUnmapMemory(logicalDevice, *memory);
-        }
-        VK_CHECK_RESULT(vkBindBufferMemory(logicalDevice, *buffer, *memory, 0));
+            memcpy(region.mapped, data, size);
+        }
+        return region;
+    }
+
+    void VulkanDevice::reclaimStaging() {
+        for (uint64_t value = stagingRing->oldestValue(); value != 0 && isRetired(value); value = stagingRing->oldestValue()) {
+            stagingRing->releaseOldest();
+        }
+    }
+
+    void VulkanDevice::releaseBuffer(AsyncUpload *upload, VkBuffer buffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask,
+                                     VkDeviceSize offset, VkDeviceSize size) {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = dstAccessMask;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = buffer;
+        barrier.offset = offset;
+        barrier.size = size;
+        if (!hasDedicatedTransferQueue()) {
+            vkCmdPipelineBarrier(upload->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+            return;
+        }
+        // Release half of the ownership transfer, the matching acquire runs on the graphics queue
+        barrier.srcQueueFamilyIndex = queueIndices.transferIdx;
+        barrier.dstQueueFamilyIndex = queueIndices.graphicsIdx;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(upload->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = dstAccessMask;
+        upload->acquireBufferBarriers.push_back(barrier);
+        upload->dstStageMask |= dstStageMask;
+    }
+
+    void VulkanDevice::releaseImage(AsyncUpload *upload, VkImage image, VkImageSubresourceRange subresourceRange, VkImageLayout newLayout,
+                                    VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = dstAccessMask;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = subresourceRange;
+        if (!hasDedicatedTransferQueue()) {
+            vkCmdPipelineBarrier(upload->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+            return;
+        }
+        // The layout transition is part of the transfer and must match on both queues
+        barrier.srcQueueFamilyIndex = queueIndices.transferIdx;
+        barrier.dstQueueFamilyIndex = queueIndices.graphicsIdx;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(upload->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = dstAccessMask;
+        upload->acquireImageBarriers.push_back(barrier);
+        upload->dstStageMask |= dstStageMask;
+    }
+
+    uint64_t VulkanDevice::submitUpload(AsyncUpload *upload) {
+        VK_CHECK_RESULT(vkEndCommandBuffer(upload->commandBuffer));
+
+        PendingUpload pending{};
+        pending.upload = upload;
+        QueueSubmission copySubmission;
+        copySubmission.commandBuffers.push_back(upload->commandBuffer);
+        pending.value = submit(transferQueue, copySubmission);
+        stagingRing->submit(upload, pending.value);
+        if (!hasDedicatedTransferQueue() || (upload->acquireBufferBarriers.empty() && upload->acquireImageBarriers.empty())) {
+            pendingUploads.push_back(pending);
+            return pending.value;
+        }
+
+        // Queued ahead of any frame that uses the resources, so no draw can see them before the acquire
+        pending.acquireCommandBuffer = createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+        vkCmdPipelineBarrier(pending.acquireCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, upload->dstStageMask, 0, 0, nullptr,
+                             static_cast<uint32_t>(upload->acquireBufferBarriers.size()), upload->acquireBufferBarriers.data(),
+                             static_cast<uint32_t>(upload->acquireImageBarriers.size()), upload->acquireImageBarriers.data());
+        VK_CHECK_RESULT(vkEndCommandBuffer(pending.acquireCommandBuffer));
+
+        QueueSubmission acquireSubmission;
+        acquireSubmission.commandBuffers.push_back(pending.acquireCommandBuffer);
+        acquireSubmission.wait(getTimelineSemaphore(transferQueue), upload->dstStageMask, pending.value);
+        pending.value = submit(graphicsQueue, acquireSubmission);
+        pendingUploads.push_back(pending);
+        return pending.value;
+    }
+
+    void VulkanDevice::flushUpload(AsyncUpload *upload) {
+        waitRetired(submitUpload(upload));
+        collectUploads();
+    }
+
+    void VulkanDevice::collectUploads(bool wait) {
+        auto it = pendingUploads.begin();
+        while (it != pendingUploads.end()) {
+            if (wait) {
+                waitRetired(it->value);
+            } else if (!isRetired(it->value)) {
+                ++it;
+                continue;
+            }
+            for (auto &callback : it->upload->onComplete) {
+                callback();
+            }
+            transferOneShotPool->recycle(it->upload->commandBuffer);
+            if (it->acquireCommandBuffer != VK_NULL_HANDLE) {
+                graphicsOneShotPool->recycle(it->acquireCommandBuffer);
+            }
+            delete it->upload;
+            it = pendingUploads.erase(it);
+        }
+        reclaimStaging();
+    }
+
+    void VulkanDevice::retire(std::function<void()> destroy, uint64_t lastUse) {
+        RetiredResource resource;
+        resource.lastUses.fill(0);
+        if (lastUse != 0) {
+            resource.lastUses[lastUse & (MAX_TIMELINES - 1)] = lastUse;
+        } else {
+            // Without a known last use the resource may be in flight on any queue
+            for (size_t i = 0; i < timelines.size(); i++) {
+                resource.lastUses[i] = timelines[i].lastSubmitted;
+            }
+        }
+        resource.destroy = destroy;
+        retiredResources.push_back(resource);
+    }
+
+    GeometryPool *VulkanDevice::getGeometryPool(uint32_t vertexStride) {
+        if (geometryPool == nullptr) {
+            geometryPool = new GeometryPool(this, vertexStride);
+        } else if (geometryPool->getVertexStride() != vertexStride) {
+            throw std::runtime_error("geometry pool vertex stride mismatch!");
+        }
+        return geometryPool;
+    }
+
+    void VulkanDevice::collectRetired(bool force) {
+        auto it = retiredResources.begin();
+        while (it != retiredResources.end()) {
+            bool retired = true;
+            for (size_t i = 0; i < timelines.size() && retired && !force; i++) {
+                retired = isRetired(timelines[i], it->lastUses[i]);
+            }
+            if (retired) {
+                it->destroy();
+                it = retiredResources.erase(it);
+            } else {
+                ++it;
+            }
+        }
     }
 }
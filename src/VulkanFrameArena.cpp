@@ -0,0 +1,68 @@
+#include "VulkanFrameArena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+namespace VulkanBase {
+    LinearArena::LinearArena(size_t blockSize) {
+        blocks.push_back(Block{static_cast<char *>(::operator new(blockSize)), blockSize});
+    }
+
+    LinearArena::~LinearArena() {
+        for (auto &block : blocks) {
+            ::operator delete(block.data);
+        }
+    }
+
+    void *LinearArena::allocate(size_t size, size_t alignment) {
+        while (true) {
+            Block &block = blocks[currentBlock];
+            uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+            size_t alignedOffset = ((base + offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - base;
+            if (alignedOffset + size <= block.size) {
+                offset = alignedOffset + size;
+                return block.data + alignedOffset;
+            }
+            // Blocks past the current one were kept by a rewind and are reused before allocating new ones
+            currentBlock++;
+            offset = 0;
+            if (currentBlock == blocks.size()) {
+                size_t blockSize = std::max(blocks.back().size, size + alignment);
+                blocks.push_back(Block{static_cast<char *>(::operator new(blockSize)), blockSize});
+            }
+        }
+    }
+
+    void LinearArena::reset() {
+        if (blocks.size() > 1) {
+            // Next time everything fits into a single block
+            size_t total = capacity();
+            for (auto &block : blocks) {
+                ::operator delete(block.data);
+            }
+            blocks.clear();
+            blocks.push_back(Block{static_cast<char *>(::operator new(total)), total});
+        }
+        currentBlock = 0;
+        offset = 0;
+    }
+
+    LinearArena::Marker LinearArena::mark() const {
+        return Marker{currentBlock, offset};
+    }
+
+    void LinearArena::rewind(Marker marker) {
+        assert(marker.block < currentBlock || (marker.block == currentBlock && marker.offset <= offset));
+        currentBlock = marker.block;
+        offset = marker.offset;
+    }
+
+    size_t LinearArena::capacity() const {
+        size_t total = 0;
+        for (const auto &block : blocks) {
+            total += block.size;
+        }
+        return total;
+    }
+}
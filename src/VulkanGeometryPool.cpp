@@ -0,0 +1,103 @@
+#include "VulkanGeometryPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace VulkanBase {
+    GeometryPool::RangeList::RangeList(uint32_t capacity) {
+        freeRanges.push_back(Range{0, capacity});
+    }
+
+    bool GeometryPool::RangeList::allocate(uint32_t count, uint32_t &first) {
+        if (count == 0) {
+            first = 0;
+            return true;
+        }
+        for (size_t i = 0; i < freeRanges.size(); i++) {
+            if (freeRanges[i].count < count) {
+                continue;
+            }
+            first = freeRanges[i].first;
+            freeRanges[i].first += count;
+            freeRanges[i].count -= count;
+            if (freeRanges[i].count == 0) {
+                freeRanges.erase(freeRanges.begin() + i);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void GeometryPool::RangeList::release(uint32_t first, uint32_t count) {
+        if (count == 0) {
+            return;
+        }
+        auto range = std::lower_bound(freeRanges.begin(), freeRanges.end(), first, [](const Range &candidate, uint32_t value) {
+            return candidate.first < value;
+        });
+        range = freeRanges.insert(range, Range{first, count});
+        if (range + 1 != freeRanges.end() && range->first + range->count == (range + 1)->first) {
+            range->count += (range + 1)->count;
+            freeRanges.erase(range + 1);
+        }
+        if (range != freeRanges.begin() && (range - 1)->first + (range - 1)->count == range->first) {
+            (range - 1)->count += range->count;
+            freeRanges.erase(range);
+        }
+    }
+
+    GeometryPool::GeometryPool(VulkanDevice *device, uint32_t vertexStride, VkDeviceSize vertexCapacity, VkDeviceSize indexCapacity)
+            : device(device), vertexStride(vertexStride), vertexRanges(static_cast<uint32_t>(vertexCapacity / vertexStride)),
+              indexRanges(static_cast<uint32_t>(indexCapacity / sizeof(uint32_t))) {
+        device->createBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                             &vertexBuffer, &vertexAllocation, vertexCapacity / vertexStride * vertexStride);
+        device->createBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                             &indexBuffer, &indexAllocation, indexCapacity);
+    }
+
+    GeometryPool::~GeometryPool() {
+        vkDestroyBuffer(device->logicalDevice, vertexBuffer, nullptr);
+        device->allocator->free(vertexAllocation);
+        vkDestroyBuffer(device->logicalDevice, indexBuffer, nullptr);
+        device->allocator->free(indexAllocation);
+    }
+
+    GeometryRange GeometryPool::allocate(uint32_t vertexCount, uint32_t indexCount) {
+        std::lock_guard<std::mutex> lock(mutex);
+        GeometryRange range;
+        range.vertexCount = vertexCount;
+        range.indexCount = indexCount;
+        if (!vertexRanges.allocate(vertexCount, range.firstVertex)) {
+            throw std::runtime_error("geometry pool is out of vertex space!");
+        }
+        if (!indexRanges.allocate(indexCount, range.firstIndex)) {
+            vertexRanges.release(range.firstVertex, vertexCount);
+            throw std::runtime_error("geometry pool is out of index space!");
+        }
+        return range;
+    }
+
+    void GeometryPool::free(const GeometryRange &range) {
+        std::lock_guard<std::mutex> lock(mutex);
+        vertexRanges.release(range.firstVertex, range.vertexCount);
+        indexRanges.release(range.firstIndex, range.indexCount);
+    }
+
+    void GeometryPool::bind(VkCommandBuffer cmdBuffer) const {
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &vertexBuffer, &offset);
+        vkCmdBindIndexBuffer(cmdBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    }
+
+    uint32_t GeometryPool::getVertexStride() const {
+        return vertexStride;
+    }
+
+    VkDeviceSize GeometryPool::vertexByteOffset(const GeometryRange &range) const {
+        return static_cast<VkDeviceSize>(range.firstVertex) * vertexStride;
+    }
+
+    VkDeviceSize GeometryPool::indexByteOffset(const GeometryRange &range) const {
+        return static_cast<VkDeviceSize>(range.firstIndex) * sizeof(uint32_t);
+    }
+}
@@ -0,0 +1,319 @@
+#include "VulkanMemoryAllocator.h"
+#include "VulkanTools.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace VulkanBase {
+    const char *memoryCategoryName(MemoryCategory category) {
+        switch (category) {
+            case MemoryCategory::Mesh: return "Meshes";
+            case MemoryCategory::Texture: return "Textures";
+            case MemoryCategory::RenderTarget: return "Render targets";
+            case MemoryCategory::Staging: return "Staging";
+            case MemoryCategory::Uniform: return "Uniforms";
+            case MemoryCategory::Other: return "Other";
+            default: return "Unknown";
+        }
+    }
+
+    MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkDeviceSize blockSize) : logicalDevice(logicalDevice) {
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+        const uint32_t kindCount = static_cast<uint32_t>(ResourceKind::Count);
+        pools.resize(memoryProperties.memoryTypeCount * kindCount);
+        for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++) {
+            // Small heaps such as the host visible device local window would be exhausted by a few full size blocks
+            VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[type].heapIndex].size;
+            VkDeviceSize poolBlockSize = std::max<VkDeviceSize>(std::min(blockSize, heapSize / 8), 1024 * 1024);
+            for (uint32_t kind = 0; kind < kindCount; kind++) {
+                Pool &pool = pools[type * kindCount + kind];
+                pool.memoryType = type;
+                pool.kind = static_cast<ResourceKind>(kind);
+                pool.blockSize = poolBlockSize;
+                pool.allocationCount = 0;
+            }
+        }
+    }
+
+    MemoryAllocator::~MemoryAllocator() {
+        for (auto &pool : pools) {
+            for (auto &block : pool.blocks) {
+                vkFreeMemory(logicalDevice, block.memory, nullptr);
+            }
+        }
+    }
+
+    Allocation MemoryAllocator::allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags propertyFlags, bool deviceAddress, MemoryCategory category) {
+        VkBufferMemoryRequirementsInfo2 requirementsInfo{};
+        requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+        requirementsInfo.buffer = buffer;
+        VkMemoryDedicatedRequirements dedicatedRequirements{};
+        dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+        VkMemoryRequirements2 requirements{};
+        requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        requirements.pNext = &dedicatedRequirements;
+        vkGetBufferMemoryRequirements2(logicalDevice, &requirementsInfo, &requirements);
+
+        bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+        Allocation allocation = allocate(requirements.memoryRequirements, propertyFlags, deviceAddress ? ResourceKind::DeviceAddress : ResourceKind::Linear,
+                                         dedicated, buffer, VK_NULL_HANDLE);
+        allocation.category = category;
+        track(allocation, true);
+        VK_CHECK_RESULT(vkBindBufferMemory(logicalDevice, buffer, allocation.memory, allocation.offset));
+        return allocation;
+    }
+
+    Allocation MemoryAllocator::allocateImage(VkImage image, VkMemoryPropertyFlags propertyFlags, bool linearTiling, MemoryCategory category) {
+        VkImageMemoryRequirementsInfo2 requirementsInfo{};
+        requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+        requirementsInfo.image = image;
+        VkMemoryDedicatedRequirements dedicatedRequirements{};
+        dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+        VkMemoryRequirements2 requirements{};
+        requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        requirements.pNext = &dedicatedRequirements;
+        vkGetImageMemoryRequirements2(logicalDevice, &requirementsInfo, &requirements);
+
+        bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+        Allocation allocation = allocate(requirements.memoryRequirements, propertyFlags, linearTiling ? ResourceKind::Linear : ResourceKind::Optimal,
+                                         dedicated, VK_NULL_HANDLE, image);
+        allocation.category = category;
+        track(allocation, true);
+        VK_CHECK_RESULT(vkBindImageMemory(logicalDevice, image, allocation.memory, allocation.offset));
+        return allocation;
+    }
+
+    void MemoryAllocator::free(Allocation &allocation) {
+        if (allocation.memory == VK_NULL_HANDLE) {
+            return;
+        }
+        track(allocation, false);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (allocation.pool == Allocation::DEDICATED) {
+            freeMemory(allocation.memory, allocation.size, allocation.memoryType);
+            dedicatedCount--;
+            dedicatedBytes -= allocation.size;
+            allocation = Allocation();
+            return;
+        }
+
+        Pool &pool = pools[allocation.pool];
+        auto block = std::find_if(pool.blocks.begin(), pool.blocks.end(), [&allocation](const Block &candidate) {
+            return candidate.memory == allocation.memory;
+        });
+        if (block == pool.blocks.end()) {
+            throw std::runtime_error("freed allocation does not belong to the allocator!");
+        }
+        std::vector<Range> &ranges = block->freeRanges;
+        auto range = std::lower_bound(ranges.begin(), ranges.end(), allocation.offset, [](const Range &candidate, VkDeviceSize offset) {
+            return candidate.offset < offset;
+        });
+        range = ranges.insert(range, Range{allocation.offset, allocation.size});
+        if (range + 1 != ranges.end() && range->offset + range->size == (range + 1)->offset) {
+            range->size += (range + 1)->size;
+            ranges.erase(range + 1);
+        }
+        if (range != ranges.begin() && (range - 1)->offset + (range - 1)->size == range->offset) {
+            (range - 1)->size += range->size;
+            ranges.erase(range);
+        }
+        block->used -= allocation.size;
+        pool.allocationCount--;
+
+        // Keep one block around so a pool that empties and refills does not thrash vkAllocateMemory
+        if (block->used == 0 && pool.blocks.size() > 1) {
+            freeMemory(block->memory, block->size, pool.memoryType);
+            pool.blocks.erase(block);
+        }
+        allocation = Allocation();
+    }
+
+    void MemoryAllocator::flush(const Allocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+        VkMemoryPropertyFlags propertyFlags = memoryProperties.memoryTypes[allocation.memoryType].propertyFlags;
+        if (propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+            return;
+        }
+        if (size == VK_WHOLE_SIZE) {
+            size = allocation.size - offset;
+        }
+        // Non-coherent allocations are atom aligned, so the widened range stays inside the allocation
+        VkMappedMemoryRange mappedRange{};
+        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        mappedRange.memory = allocation.memory;
+        mappedRange.offset = (allocation.offset + offset) / nonCoherentAtomSize * nonCoherentAtomSize;
+        mappedRange.size = std::min(Tools::alignedVkSize(allocation.offset + offset + size - mappedRange.offset, nonCoherentAtomSize),
+                                    allocation.offset + allocation.size - mappedRange.offset);
+        VK_CHECK_RESULT(vkFlushMappedMemoryRanges(logicalDevice, 1, &mappedRange));
+    }
+
+    uint32_t MemoryAllocator::getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags propertyFlags) const {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & propertyFlags) == propertyFlags) {
+                return i;
+            }
+        }
+        throw std::runtime_error("Unable to find a matching memory type!");
+    }
+
+    MemoryStatistics MemoryAllocator::getStatistics() {
+        std::lock_guard<std::mutex> lock(mutex);
+        MemoryStatistics statistics;
+        for (const auto &pool : pools) {
+            statistics.allocationCount += pool.allocationCount;
+            for (const auto &block : pool.blocks) {
+                statistics.deviceMemoryCount++;
+                statistics.reservedBytes += block.size;
+                statistics.usedBytes += block.used;
+            }
+        }
+        statistics.deviceMemoryCount += dedicatedCount;
+        statistics.allocationCount += dedicatedCount;
+        statistics.dedicatedCount = dedicatedCount;
+        statistics.reservedBytes += dedicatedBytes;
+        statistics.usedBytes += dedicatedBytes;
+        statistics.categoryBytes = categoryBytes;
+        statistics.heapReservedBytes = heapReservedBytes;
+        statistics.heapUsedBytes = heapUsedBytes;
+        return statistics;
+    }
+
+    Allocation MemoryAllocator::allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags propertyFlags, ResourceKind kind, bool dedicated,
+                                         VkBuffer buffer, VkImage image) {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint32_t memoryType = getMemoryType(requirements.memoryTypeBits, propertyFlags);
+        VkMemoryRequirements alignedRequirements = requirements;
+        VkMemoryPropertyFlags typeFlags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+        if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+            // Flushes work on whole atoms, which must not reach into a neighbouring allocation
+            alignedRequirements.alignment = std::max(alignedRequirements.alignment, nonCoherentAtomSize);
+            alignedRequirements.size = Tools::alignedVkSize(alignedRequirements.size, nonCoherentAtomSize);
+        }
+
+        const uint32_t poolIndex = memoryType * static_cast<uint32_t>(ResourceKind::Count) + static_cast<uint32_t>(kind);
+        Pool &pool = pools[poolIndex];
+        // Lazily allocated memory is committed per memory object, sharing a block would defeat it
+        dedicated = dedicated || (typeFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+        if (dedicated || alignedRequirements.size > pool.blockSize / 2) {
+            return allocateDedicated(alignedRequirements, memoryType, kind, buffer, image);
+        }
+
+        Allocation allocation;
+        allocation.memoryType = memoryType;
+        allocation.pool = poolIndex;
+        for (auto &block : pool.blocks) {
+            if (allocateFromBlock(block, alignedRequirements, allocation)) {
+                pool.allocationCount++;
+                return allocation;
+            }
+        }
+
+        Block block{};
+        block.size = pool.blockSize;
+        block.used = 0;
+        block.memory = allocateMemory(block.size, memoryType, kind, VK_NULL_HANDLE, VK_NULL_HANDLE, &block.mapped);
+        block.freeRanges.push_back(Range{0, block.size});
+        pool.blocks.push_back(block);
+        allocateFromBlock(pool.blocks.back(), alignedRequirements, allocation);
+        pool.allocationCount++;
+        return allocation;
+    }
+
+    Allocation MemoryAllocator::allocateDedicated(const VkMemoryRequirements &requirements, uint32_t memoryType, ResourceKind kind, VkBuffer buffer,
+                                                  VkImage image) {
+        Allocation allocation;
+        allocation.memory = allocateMemory(requirements.size, memoryType, kind, buffer, image, &allocation.mapped);
+        allocation.offset = 0;
+        allocation.size = requirements.size;
+        allocation.memoryType = memoryType;
+        allocation.pool = Allocation::DEDICATED;
+        dedicatedCount++;
+        dedicatedBytes += requirements.size;
+        return allocation;
+    }
+
+    bool MemoryAllocator::allocateFromBlock(Block &block, const VkMemoryRequirements &requirements, Allocation &allocation) const {
+        std::vector<Range> &ranges = block.freeRanges;
+        for (size_t i = 0; i < ranges.size(); i++) {
+            VkDeviceSize offset = Tools::alignedVkSize(ranges[i].offset, requirements.alignment);
+            VkDeviceSize end = offset + requirements.size;
+            VkDeviceSize rangeEnd = ranges[i].offset + ranges[i].size;
+            if (end > rangeEnd) {
+                continue;
+            }
+            // Alignment padding in front stays in the free list
+            if (offset > ranges[i].offset) {
+                ranges[i].size = offset - ranges[i].offset;
+                if (end < rangeEnd) {
+                    ranges.insert(ranges.begin() + i + 1, Range{end, rangeEnd - end});
+                }
+            } else if (end < rangeEnd) {
+                ranges[i].offset = end;
+                ranges[i].size = rangeEnd - end;
+            } else {
+                ranges.erase(ranges.begin() + i);
+            }
+            block.used += requirements.size;
+            allocation.memory = block.memory;
+            allocation.offset = offset;
+            allocation.size = requirements.size;
+            allocation.mapped = block.mapped ? static_cast<char *>(block.mapped) + offset : nullptr;
+            return true;
+        }
+        return false;
+    }
+
+    VkDeviceMemory MemoryAllocator::allocateMemory(VkDeviceSize size, uint32_t memoryType, ResourceKind kind, VkBuffer buffer, VkImage image, void **mapped) {
+        VkMemoryAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.allocationSize = size;
+        allocateInfo.memoryTypeIndex = memoryType;
+
+        VkMemoryAllocateFlagsInfo flagsInfo{};
+        flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+        flagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+        if (kind == ResourceKind::DeviceAddress) {
+            allocateInfo.pNext = &flagsInfo;
+        }
+        VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+        dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+        dedicatedInfo.buffer = buffer;
+        dedicatedInfo.image = image;
+        if (buffer != VK_NULL_HANDLE || image != VK_NULL_HANDLE) {
+            dedicatedInfo.pNext = allocateInfo.pNext;
+            allocateInfo.pNext = &dedicatedInfo;
+        }
+
+        VkDeviceMemory memory;
+        VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &allocateInfo, nullptr, &memory));
+        heapReservedBytes[memoryProperties.memoryTypes[memoryType].heapIndex] += size;
+        *mapped = nullptr;
+        if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            VK_CHECK_RESULT(vkMapMemory(logicalDevice, memory, 0, VK_WHOLE_SIZE, 0, mapped));
+        }
+        return memory;
+    }
+
+    void MemoryAllocator::freeMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType) {
+        vkFreeMemory(logicalDevice, memory, nullptr);
+        heapReservedBytes[memoryProperties.memoryTypes[memoryType].heapIndex] -= size;
+    }
+
+    void MemoryAllocator::track(const Allocation &allocation, bool allocated) {
+        std::lock_guard<std::mutex> lock(mutex);
+        VkDeviceSize &heapBytes = heapUsedBytes[memoryProperties.memoryTypes[allocation.memoryType].heapIndex];
+        VkDeviceSize &bytes = categoryBytes[static_cast<size_t>(allocation.category)];
+        if (allocated) {
+            heapBytes += allocation.size;
+            bytes += allocation.size;
+        } else {
+            heapBytes -= allocation.size;
+            bytes -= allocation.size;
+        }
+    }
+}
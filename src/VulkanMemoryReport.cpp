@@ -0,0 +1,77 @@
+#include "VulkanMemoryReport.h"
+
+#include <fstream>
+#include <iostream>
+
+#include "imgui.h"
+
+namespace VulkanBase {
+    static double toMegabytes(VkDeviceSize bytes) {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+
+    void MemoryReport::init(VulkanDevice *device) {
+        this->device = device;
+    }
+
+    void MemoryReport::drawPanel() {
+        ImGui::Begin("Memory");
+        ImGui::Text("VK_EXT_memory_budget: %s", device->memoryBudgetSupported ? "yes" : "no");
+        MemoryStatistics statistics = device->allocator->getStatistics();
+        uint32_t heapCount = device->getMemoryBudget(heaps);
+        if (ImGui::CollapsingHeader("Heaps", ImGuiTreeNodeFlags_DefaultOpen)) {
+            ImGui::Text("%-6s %9s %9s %9s %9s", "MB", "usage", "budget", "reserved", "used");
+            for (uint32_t i = 0; i < heapCount; i++) {
+                char name[16];
+                snprintf(name, sizeof(name), "%u%s", i, (heaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " VRAM" : "");
+                bool overBudget = heaps[i].usage > heaps[i].budget * warningThreshold;
+                if (overBudget) {
+                    ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.3f, 0.3f, 1.0f));
+                }
+                ImGui::Text("%-6s %9.1f %9.1f %9.1f %9.1f", name, toMegabytes(heaps[i].usage), toMegabytes(heaps[i].budget),
+                            toMegabytes(statistics.heapReservedBytes[i]), toMegabytes(statistics.heapUsedBytes[i]));
+                if (overBudget) {
+                    ImGui::PopStyleColor();
+                }
+            }
+        }
+        if (ImGui::CollapsingHeader("Categories", ImGuiTreeNodeFlags_DefaultOpen)) {
+            for (size_t i = 0; i < statistics.categoryBytes.size(); i++) {
+                ImGui::Text("%-16s %9.1f MB", memoryCategoryName(static_cast<MemoryCategory>(i)), toMegabytes(statistics.categoryBytes[i]));
+            }
+            ImGui::Text("%u allocations in %u device memory objects, %u dedicated", statistics.allocationCount, statistics.deviceMemoryCount,
+                        statistics.dedicatedCount);
+        }
+        if (ImGui::Button("Export")) {
+            exportJSON("memory.json");
+        }
+        ImGui::End();
+    }
+
+    bool MemoryReport::exportJSON(const std::string &filePath) const {
+        std::ofstream file(filePath);
+        if (!file.is_open()) {
+            std::cout << "failed to open file: " << filePath << std::endl;
+            return false;
+        }
+        MemoryStatistics statistics = device->allocator->getStatistics();
+        std::array<HeapBudget, VK_MAX_MEMORY_HEAPS> heaps;
+        uint32_t heapCount = device->getMemoryBudget(heaps);
+        file << "{\n  \"memoryBudget\": " << (device->memoryBudgetSupported ? "true" : "false");
+        file << ",\n  \"heaps\": [";
+        for (uint32_t i = 0; i < heapCount; i++) {
+            file << (i == 0 ? "\n    " : ",\n    ");
+            file << "{\"size\": " << heaps[i].size << ", \"deviceLocal\": " << ((heaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false")
+                 << ", \"budget\": " << heaps[i].budget << ", \"usage\": " << heaps[i].usage << ", \"reserved\": " << statistics.heapReservedBytes[i]
+                 << ", \"used\": " << statistics.heapUsedBytes[i] << "}";
+        }
+        file << "\n  ],\n  \"categories\": {";
+        for (size_t i = 0; i < statistics.categoryBytes.size(); i++) {
+            file << (i == 0 ? "\n    " : ",\n    ");
+            file << "\"" << memoryCategoryName(static_cast<MemoryCategory>(i)) << "\": " << statistics.categoryBytes[i];
+        }
+        file << "\n  },\n  \"allocations\": " << statistics.allocationCount << ",\n  \"deviceMemoryObjects\": " << statistics.deviceMemoryCount
+             << ",\n  \"dedicated\": " << statistics.dedicatedCount << "\n}\n";
+        return true;
+    }
+}
@@ -0,0 +1,235 @@
+#include "VulkanMeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace VulkanBase {
+    namespace {
+        const uint32_t MAGIC = 0x4853454d; // "MESH"
+        const uint64_t BLOB_ALIGNMENT = 64;
+
+        // Whole seconds would miss an exporter rewriting the file with the same size within a second
+        bool sourceStamp(const std::string &sourcePath, uint64_t &size, int64_t &modified) {
+#ifdef _WIN32
+            WIN32_FILE_ATTRIBUTE_DATA attributes;
+            if (!GetFileAttributesExA(sourcePath.c_str(), GetFileExInfoStandard, &attributes)) {
+                return false;
+            }
+            size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+            modified = static_cast<int64_t>((static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) |
+                                            attributes.ftLastWriteTime.dwLowDateTime);
+#else
+            struct stat status;
+            if (stat(sourcePath.c_str(), &status) != 0) {
+                return false;
+            }
+#ifdef __APPLE__
+            const struct timespec &modifiedTime = status.st_mtimespec;
+#else
+            const struct timespec &modifiedTime = status.st_mtim;
+#endif
+            size = static_cast<uint64_t>(status.st_size);
+            modified = static_cast<int64_t>(modifiedTime.tv_sec) * 1000000000 + modifiedTime.tv_nsec;
+#endif
+            return true;
+        }
+
+        uint64_t alignOffset(uint64_t offset) {
+            return (offset + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT;
+        }
+
+        // Word at a time so verifying the blobs keeps up with reading them
+        uint64_t checksum(const char *data, size_t size, uint64_t hash) {
+            size_t words = size / sizeof(uint64_t);
+            for (size_t i = 0; i < words; i++) {
+                uint64_t word;
+                std::memcpy(&word, data + i * sizeof(uint64_t), sizeof(uint64_t));
+                hash = (hash ^ word) * 0x100000001b3ull;
+                hash ^= hash >> 29;
+            }
+            for (size_t i = words * sizeof(uint64_t); i < size; i++) {
+                hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        const uint64_t CHECKSUM_SEED = 0xcbf29ce484222325ull;
+    }
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    bool MappedFile::open(const std::string &filePath) {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            CloseHandle(file);
+            return false;
+        }
+        void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+        fileHandle = file;
+        mappingHandle = mapping;
+        mapped = static_cast<const char *>(view);
+        length = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int file = ::open(filePath.c_str(), O_RDONLY);
+        if (file < 0) {
+            return false;
+        }
+        struct stat status;
+        if (fstat(file, &status) != 0 || status.st_size == 0) {
+            ::close(file);
+            return false;
+        }
+        void *view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        // The mapping keeps the file referenced on its own
+        ::close(file);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+        madvise(view, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+        mapped = static_cast<const char *>(view);
+        length = static_cast<size_t>(status.st_size);
+#endif
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (mapped == nullptr) {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(mapped);
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        fileHandle = nullptr;
+        mappingHandle = nullptr;
+#else
+        munmap(const_cast<char *>(mapped), length);
+#endif
+        mapped = nullptr;
+        length = 0;
+    }
+
+    const char *MappedFile::data() const {
+        return mapped;
+    }
+
+    size_t MappedFile::size() const {
+        return length;
+    }
+
+    namespace MeshCache {
+        std::string cachePath(const std::string &sourcePath) {
+            return sourcePath + ".meshcache";
+        }
+
+        bool open(const std::string &sourcePath, uint32_t flags, MappedFile &file, const MeshCacheHeader *&header) {
+            uint64_t sourceSize;
+            int64_t sourceModified;
+            if (!sourceStamp(sourcePath, sourceSize, sourceModified) || !file.open(cachePath(sourcePath))) {
+                return false;
+            }
+            if (file.size() < sizeof(MeshCacheHeader)) {
+                file.close();
+                return false;
+            }
+            header = reinterpret_cast<const MeshCacheHeader *>(file.data());
+            uint64_t vertexBytes = static_cast<uint64_t>(header->vertexCount) * sizeof(Vertex);
+            uint64_t indexBytes = static_cast<uint64_t>(header->indexCount) * sizeof(uint32_t);
+            bool valid = header->magic == MAGIC &&
+                         header->version == VERSION &&
+                         header->vertexStride == sizeof(Vertex) &&
+                         header->flags == flags &&
+                         header->sourceSize == sourceSize &&
+                         header->sourceModified == sourceModified &&
+                         header->vertexOffset % BLOB_ALIGNMENT == 0 &&
+                         header->indexOffset >= header->vertexOffset + vertexBytes &&
+                         header->indexOffset + indexBytes <= file.size();
+            if (valid) {
+                uint64_t hash = checksum(file.data() + header->vertexOffset, vertexBytes, CHECKSUM_SEED);
+                hash = checksum(file.data() + header->indexOffset, indexBytes, hash);
+                valid = hash == header->checksum;
+            }
+            if (!valid) {
+                header = nullptr;
+                file.close();
+            }
+            return valid;
+        }
+
+        bool write(const std::string &sourcePath, uint32_t flags, const std::vector<Vertex> &vertices,
+                   const std::vector<uint32_t> &indices, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) {
+            MeshCacheHeader header{};
+            if (!sourceStamp(sourcePath, header.sourceSize, header.sourceModified)) {
+                return false;
+            }
+            uint64_t vertexBytes = vertices.size() * sizeof(Vertex);
+            uint64_t indexBytes = indices.size() * sizeof(uint32_t);
+            header.magic = MAGIC;
+            header.version = VERSION;
+            header.vertexStride = sizeof(Vertex);
+            header.flags = flags;
+            header.vertexCount = static_cast<uint32_t>(vertices.size());
+            header.indexCount = static_cast<uint32_t>(indices.size());
+            header.vertexOffset = alignOffset(sizeof(MeshCacheHeader));
+            header.indexOffset = alignOffset(header.vertexOffset + vertexBytes);
+            header.checksum = checksum(reinterpret_cast<const char *>(vertices.data()), vertexBytes, CHECKSUM_SEED);
+            header.checksum = checksum(reinterpret_cast<const char *>(indices.data()), indexBytes, header.checksum);
+            std::memcpy(header.boundsMin, &boundsMin, sizeof(header.boundsMin));
+            std::memcpy(header.boundsMax, &boundsMax, sizeof(header.boundsMax));
+
+            // Written aside and moved over the old cache, so a reader never maps a half written file
+            std::string finalPath = cachePath(sourcePath);
+            std::string tempPath = finalPath + ".tmp";
+            {
+                std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+                if (!file.is_open()) {
+                    return false;
+                }
+                const char padding[BLOB_ALIGNMENT] = {};
+                file.write(reinterpret_cast<const char *>(&header), sizeof(MeshCacheHeader));
+                file.write(padding, static_cast<std::streamsize>(header.vertexOffset - sizeof(MeshCacheHeader)));
+                file.write(reinterpret_cast<const char *>(vertices.data()), static_cast<std::streamsize>(vertexBytes));
+                file.write(padding, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - vertexBytes));
+                file.write(reinterpret_cast<const char *>(indices.data()), static_cast<std::streamsize>(indexBytes));
+                if (!file.good()) {
+                    file.close();
+                    std::remove(tempPath.c_str());
+                    return false;
+                }
+            }
+            std::remove(finalPath.c_str());
+            return std::rename(tempPath.c_str(), finalPath.c_str()) == 0;
+        }
+    }
+}
@@ -0,0 +1,258 @@
+#include "VulkanMeshOptimizer.h"
+
+#include <algorithm>
+
+namespace VulkanBase {
+    namespace {
+        const uint32_t INVALID_VERTEX = ~0u;
+
+        // FIFO cache, a vertex stays resident until cacheSize other vertices were loaded after it
+        uint32_t simulateCache(const uint32_t *indices, size_t count, std::vector<uint32_t> &timestamps, uint32_t &time,
+                               uint32_t cacheSize) {
+            uint32_t misses = 0;
+            for (size_t i = 0; i < count; i++) {
+                uint32_t vertex = indices[i];
+                if (time - timestamps[vertex] > cacheSize) {
+                    timestamps[vertex] = time++;
+                    misses++;
+                }
+            }
+            return misses;
+        }
+    }
+
+    namespace MeshOptimizer {
+        VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize) {
+            VertexCacheStatistics statistics;
+            if (indices.empty()) {
+                return statistics;
+            }
+            std::vector<uint32_t> timestamps(vertexCount, 0);
+            uint32_t time = cacheSize + 1;
+            uint32_t misses = simulateCache(indices.data(), indices.size(), timestamps, time, cacheSize);
+
+            std::vector<bool> referenced(vertexCount, false);
+            size_t referencedCount = 0;
+            for (uint32_t index : indices) {
+                if (!referenced[index]) {
+                    referenced[index] = true;
+                    referencedCount++;
+                }
+            }
+            statistics.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+            statistics.atvr = static_cast<float>(misses) / static_cast<float>(referencedCount);
+            return statistics;
+        }
+
+        void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount, std::vector<uint32_t> &clusters,
+                                 uint32_t cacheSize) {
+            size_t triangleCount = indices.size() / 3;
+            clusters.clear();
+            if (triangleCount == 0) {
+                return;
+            }
+
+            // Triangles around each vertex, liveTriangles counts the ones not emitted yet
+            std::vector<uint32_t> liveTriangles(vertexCount, 0);
+            for (uint32_t index : indices) {
+                liveTriangles[index]++;
+            }
+            std::vector<uint32_t> offsets(vertexCount + 1, 0);
+            for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+                offsets[vertex + 1] = offsets[vertex] + liveTriangles[vertex];
+            }
+            std::vector<uint32_t> adjacency(triangleCount * 3);
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < triangleCount * 3; i++) {
+                adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+
+            std::vector<uint32_t> timestamps(vertexCount, 0);
+            std::vector<bool> emitted(triangleCount, false);
+            std::vector<uint32_t> deadEnd;
+            deadEnd.reserve(triangleCount * 3);
+            std::vector<uint32_t> result;
+            result.reserve(triangleCount * 3);
+            uint32_t time = cacheSize + 1;
+            uint32_t cursor = 0;
+            uint32_t fan = indices[0];
+            bool coldStart = true;
+
+            while (fan != INVALID_VERTEX) {
+                if (coldStart) {
+                    clusters.push_back(static_cast<uint32_t>(result.size() / 3));
+                    coldStart = false;
+                }
+                for (uint32_t i = offsets[fan]; i < offsets[fan + 1]; i++) {
+                    uint32_t triangle = adjacency[i];
+                    if (emitted[triangle]) {
+                        continue;
+                    }
+                    for (uint32_t k = 0; k < 3; k++) {
+                        uint32_t vertex = indices[triangle * 3 + k];
+                        result.push_back(vertex);
+                        deadEnd.push_back(vertex);
+                        liveTriangles[vertex]--;
+                        if (time - timestamps[vertex] > cacheSize) {
+                            timestamps[vertex] = time++;
+                        }
+                    }
+                    emitted[triangle] = true;
+                }
+
+                // Next fan is the neighbour that stays in the cache while its remaining triangles are emitted,
+                // preferring the oldest one
+                uint32_t next = INVALID_VERTEX;
+                int64_t bestPriority = -1;
+                for (uint32_t i = offsets[fan]; i < offsets[fan + 1]; i++) {
+                    uint32_t triangle = adjacency[i];
+                    for (uint32_t k = 0; k < 3; k++) {
+                        uint32_t vertex = indices[triangle * 3 + k];
+                        if (liveTriangles[vertex] == 0) {
+                            continue;
+                        }
+                        int64_t priority = 0;
+                        uint32_t age = time - timestamps[vertex];
+                        if (age + 2 * liveTriangles[vertex] <= cacheSize) {
+                            priority = age;
+                        }
+                        if (priority > bestPriority) {
+                            bestPriority = priority;
+                            next = vertex;
+                        }
+                    }
+                }
+
+                if (next == INVALID_VERTEX) {
+                    // Dead end, fall back to recently used vertices and then to any vertex left
+                    while (!deadEnd.empty()) {
+                        uint32_t vertex = deadEnd.back();
+                        deadEnd.pop_back();
+                        if (liveTriangles[vertex] > 0) {
+                            next = vertex;
+                            break;
+                        }
+                    }
+                    if (next == INVALID_VERTEX) {
+                        while (cursor < vertexCount && liveTriangles[cursor] == 0) {
+                            cursor++;
+                        }
+                        if (cursor < vertexCount) {
+                            next = cursor;
+                        }
+                    }
+                    coldStart = true;
+                }
+                fan = next;
+            }
+            indices.swap(result);
+        }
+
+        void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices, std::vector<uint32_t> clusters,
+                              float threshold, uint32_t cacheSize) {
+            size_t triangleCount = indices.size() / 3;
+            if (triangleCount == 0) {
+                return;
+            }
+            if (clusters.empty()) {
+                clusters.push_back(0);
+            }
+
+            // Soft boundaries: a new cluster starts wherever the run so far is cheap enough to survive a cache flush
+            std::vector<uint32_t> timestamps(vertices.size(), 0);
+            uint32_t time = cacheSize + 1;
+            std::vector<uint32_t> starts;
+            for (size_t c = 0; c < clusters.size(); c++) {
+                uint32_t start = clusters[c];
+                uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+                if (start == end) {
+                    continue;
+                }
+                uint32_t misses = simulateCache(&indices[start * 3], (end - start) * 3, timestamps, time, cacheSize);
+                time += cacheSize + 1;
+                float clusterThreshold = threshold * static_cast<float>(misses) / static_cast<float>(end - start);
+
+                starts.push_back(start);
+                uint32_t runMisses = 0;
+                uint32_t runTriangles = 0;
+                for (uint32_t triangle = start; triangle + 1 < end; triangle++) {
+                    runMisses += simulateCache(&indices[triangle * 3], 3, timestamps, time, cacheSize);
+                    runTriangles++;
+                    if (static_cast<float>(runMisses) <= clusterThreshold * static_cast<float>(runTriangles)) {
+                        starts.push_back(triangle + 1);
+                        runMisses = 0;
+                        runTriangles = 0;
+                        time += cacheSize + 1;
+                    }
+                }
+            }
+
+            // Area weighted centroid and normal of every cluster, sorted by how far they face out of the mesh
+            struct Cluster {
+                uint32_t start;
+                uint32_t end;
+                glm::vec3 centroid;
+                glm::vec3 normal;
+                float area;
+                float sortKey;
+            };
+            std::vector<Cluster> sorted(starts.size());
+            glm::vec3 meshCentroid(0.0f);
+            float meshArea = 0.0f;
+            for (size_t c = 0; c < starts.size(); c++) {
+                Cluster &cluster = sorted[c];
+                cluster.start = starts[c];
+                cluster.end = c + 1 < starts.size() ? starts[c + 1] : static_cast<uint32_t>(triangleCount);
+                cluster.centroid = glm::vec3(0.0f);
+                cluster.normal = glm::vec3(0.0f);
+                cluster.area = 0.0f;
+                for (uint32_t triangle = cluster.start; triangle < cluster.end; triangle++) {
+                    const glm::vec3 &p0 = vertices[indices[triangle * 3 + 0]].pos;
+                    const glm::vec3 &p1 = vertices[indices[triangle * 3 + 1]].pos;
+                    const glm::vec3 &p2 = vertices[indices[triangle * 3 + 2]].pos;
+                    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                    float area = glm::length(normal);
+                    cluster.centroid += (p0 + p1 + p2) * (area / 3.0f);
+                    cluster.normal += normal;
+                    cluster.area += area;
+                }
+                meshCentroid += cluster.centroid;
+                meshArea += cluster.area;
+                if (cluster.area > 0.0f) {
+                    cluster.centroid /= cluster.area;
+                }
+            }
+            if (meshArea > 0.0f) {
+                meshCentroid /= meshArea;
+            }
+            for (auto &cluster : sorted) {
+                float length = glm::length(cluster.normal);
+                cluster.sortKey = length > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / length) : 0.0f;
+            }
+            std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b) {
+                return a.sortKey > b.sortKey;
+            });
+
+            std::vector<uint32_t> result;
+            result.reserve(indices.size());
+            for (const auto &cluster : sorted) {
+                result.insert(result.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+            }
+            indices.swap(result);
+        }
+
+        void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+            std::vector<uint32_t> remap(vertices.size(), INVALID_VERTEX);
+            std::vector<Vertex> reordered;
+            reordered.reserve(vertices.size());
+            for (auto &index : indices) {
+                if (remap[index] == INVALID_VERTEX) {
+                    remap[index] = static_cast<uint32_t>(reordered.size());
+                    reordered.push_back(vertices[index]);
+                }
+                index = remap[index];
+            }
+            vertices.swap(reordered);
+        }
+    }
+}
@@ -1,9 +1,15 @@
 #include "VulkanModel.h"
+#include "VulkanVertexWelder.h"
+#include "VulkanMeshOptimizer.h"
+#include "VulkanMeshCache.h"
+#include "VulkanObjParser.h"
+#include "VulkanTangentSpace.h"
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 #include <stdexcept>
 #include <iostream>
 #include <array>
+#include <algorithm>
 
 //void Model::loadFromFile(std::string filePath, VulkanBase::VulkanDevice *device) {
 //    this->pDevice = device;
@@ -24,11 +30,26 @@
 //}
 
 
+void Model::bind(VkCommandBuffer cmdBuffer) const {
+    pDevice->getGeometryPool(sizeof(Vertex))->bind(cmdBuffer);
+}
+
+void Model::draw(VkCommandBuffer cmdBuffer, uint32_t instanceCount) const {
+    vkCmdDrawIndexed(cmdBuffer, geometry.indexCount, instanceCount, geometry.firstIndex, static_cast<int32_t>(geometry.firstVertex), 0);
+}
+
 void Model::cleanUp() {
-    vkDestroyBuffer(pDevice->logicalDevice, vertexBuffer.buffer, nullptr);
-    vkFreeMemory(pDevice->logicalDevice, vertexBuffer.memory, nullptr);
-    vkDestroyBuffer(pDevice->logicalDevice, indexBuffer.buffer, nullptr);
-    vkFreeMemory(pDevice->logicalDevice, indexBuffer.memory, nullptr);
+    pDevice->getGeometryPool(sizeof(Vertex))->free(geometry);
+    geometry = VulkanBase::GeometryRange();
+}
+
+void Model::retire() {
+    VulkanBase::GeometryPool *pool = pDevice->getGeometryPool(sizeof(Vertex));
+    VulkanBase::GeometryRange oldGeometry = geometry;
+    pDevice->retire([pool, oldGeometry]() {
+        pool->free(oldGeometry);
+    });
+    geometry = VulkanBase::GeometryRange();
 }
 
 //void Model::processNode(aiNode *node, const aiScene *scene) {
@@ -81,9 +102,51 @@ void Model::cleanUp() {
 //    }
 //}
 
-void Model::loadFromObj(std::string filePath, VulkanBase::VulkanDevice *device) {
+void Model::loadFromObj(std::string filePath, VulkanBase::VulkanDevice *device, VulkanBase::AsyncUpload *batch, bool optimize,
+                        VulkanBase::ThreadPool *threadPool) {
     this->pDevice = device;
 
+    uint32_t cacheFlags = optimize ? VulkanBase::MeshCache::FLAG_OPTIMIZED : 0;
+    VulkanBase::MappedFile cacheFile;
+    const VulkanBase::MeshCacheHeader *cache = nullptr;
+    if (VulkanBase::MeshCache::open(filePath, cacheFlags, cacheFile, cache)) {
+        boundsMin = glm::vec3(cache->boundsMin[0], cache->boundsMin[1], cache->boundsMin[2]);
+        boundsMax = glm::vec3(cache->boundsMax[0], cache->boundsMax[1], cache->boundsMax[2]);
+        std::cout << "Loading Cached Model: " << filePath << std::endl;
+        std::cout << " Vertices: " << cache->vertexCount << std::endl;
+        createBuffer(batch, reinterpret_cast<const Vertex *>(cacheFile.data() + cache->vertexOffset), cache->vertexCount,
+                     reinterpret_cast<const uint32_t *>(cacheFile.data() + cache->indexOffset), cache->indexCount);
+        return;
+    }
+
+    if (threadPool != nullptr) {
+        size_t firstIndex = indices.size();
+        size_t firstVertex = vertices.size();
+        VulkanBase::ObjParser::load(filePath, threadPool, vertices, indices);
+        std::cout << "Loading New Model: " << filePath << std::endl;
+        std::cout << " Vertices: " << vertices.size() - firstVertex << " unique of " << indices.size() - firstIndex << std::endl;
+    } else {
+        loadWithTinyObj(filePath);
+    }
+    VulkanBase::TangentSpace::generateNormals(vertices, indices);
+    VulkanBase::TangentSpace::generateTangents(vertices, indices);
+    if (optimize) {
+        optimizeMesh();
+    }
+
+    boundsMin = vertices.empty() ? glm::vec3() : vertices[0].pos;
+    boundsMax = boundsMin;
+    for (const auto &vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+    if (!VulkanBase::MeshCache::write(filePath, cacheFlags, vertices, indices, boundsMin, boundsMax)) {
+        std::cout << "failed to write mesh cache: " << VulkanBase::MeshCache::cachePath(filePath) << std::endl;
+    }
+    createBuffer(batch, vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()));
+}
+
+void Model::loadWithTinyObj(const std::string &filePath) {
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
@@ -93,7 +156,18 @@ void Model::loadFromObj(std::string filePath, VulkanBase::VulkanDevice *device)
         throw std::runtime_error("failed to load model: " + error);
     }
 
+    size_t cornerCount = 0;
+    for (const auto &shape: shapes) {
+        cornerCount += shape.mesh.indices.size();
+    }
+    indices.reserve(indices.size() + cornerCount);
+    // Corners mostly repeat a position shared by several faces, attrib.vertices is a close guess for the unique count
+    size_t expectedVertices = std::max(attrib.vertices.size() / 3, attrib.normals.size() / 3);
+    vertices.reserve(vertices.size() + expectedVertices);
+    VulkanBase::VertexWelder welder(vertices, expectedVertices);
+
     for (const auto &shape: shapes) {
+        size_t shapeVertices = vertices.size();
         for (const auto &index: shape.mesh.indices) {
             Vertex vertex{};
 
@@ -102,70 +176,70 @@ void Model::loadFromObj(std::string filePath, VulkanBase::VulkanDevice *device)
                     attrib.vertices[3 * index.vertex_index + 1],
                     attrib.vertices[3 * index.vertex_index + 2],
             };
-            vertex.texCoord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
-            vertices.push_back(vertex);
-            indices.push_back(indices.size());
+            if (index.texcoord_index >= 0) {
+                vertex.texCoord = {
+                        attrib.texcoords[2 * index.texcoord_index + 0],
+                        1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+                };
+            }
+            if (index.normal_index >= 0) {
+                vertex.normal = {
+                        attrib.normals[3 * index.normal_index + 0],
+                        attrib.normals[3 * index.normal_index + 1],
+                        attrib.normals[3 * index.normal_index + 2],
+                };
+            }
+            indices.push_back(welder.weld(vertex));
         }
         std::cout << "Loading New Model: " << filePath << std::endl;
         std::cout << " Model: " << shape.name << std::endl;
-        std::cout << " Vertices: " << vertices.size() << std::endl;
+        std::cout << " Vertices: " << vertices.size() - shapeVertices << " unique of " << shape.mesh.indices.size() << std::endl;
     }
-    createBuffer();
 }
 
-void Model::createBuffer() {
-    size_t vertexBufferSize = vertices.size() * sizeof(Vertex);
-    size_t indexBufferSize = indices.size() * sizeof(uint32_t);
-    indexBuffer.count = static_cast<uint32_t>(indices.size());
-    vertexBuffer.count = static_cast<uint32_t>(vertices.size());
-
-    struct StagingBuffer {
-        VkBuffer buffer;
-        VkDeviceMemory memory;
-    } vertexStaging, indexStaging;
-
-    pDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          &vertexStaging.buffer,
-                          &vertexStaging.memory,
-                          vertexBufferSize,
-                          vertices.data());
-    pDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          &indexStaging.buffer,
-                          &indexStaging.memory,
-                          indexBufferSize,
-                          indices.data());
-    pDevice->createBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                          &vertexBuffer.buffer,
-                          &vertexBuffer.memory,
-                          vertexBufferSize);
-    pDevice->createBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                          &indexBuffer.buffer,
-                          &indexBuffer.memory,
-                          indexBufferSize);
-
-    VkCommandBuffer copyCmd = pDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+void Model::optimizeMesh() {
+    VulkanBase::VertexCacheStatistics before = VulkanBase::MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+    std::vector<uint32_t> clusters;
+    VulkanBase::MeshOptimizer::optimizeVertexCache(indices, vertices.size(), clusters);
+    VulkanBase::MeshOptimizer::optimizeOverdraw(indices, vertices, clusters);
+    VulkanBase::MeshOptimizer::optimizeVertexFetch(vertices, indices);
+    VulkanBase::VertexCacheStatistics after = VulkanBase::MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+    std::cout << " ACMR: " << before.acmr << " -> " << after.acmr << std::endl;
+    std::cout << " ATVR: " << before.atvr << " -> " << after.atvr << std::endl;
+}
+
+void Model::createBuffer(VulkanBase::AsyncUpload *batch, const Vertex *vertexData, uint32_t vertexCount, const uint32_t *indexData,
+                         uint32_t indexCount) {
+    size_t vertexBufferSize = vertexCount * sizeof(Vertex);
+    size_t indexBufferSize = indexCount * sizeof(uint32_t);
+    VulkanBase::GeometryPool *pool = pDevice->getGeometryPool(sizeof(Vertex));
+    geometry = pool->allocate(vertexCount, indexCount);
+    VkDeviceSize vertexOffset = pool->vertexByteOffset(geometry);
+    VkDeviceSize indexOffset = pool->indexByteOffset(geometry);
+
+    VulkanBase::AsyncUpload *upload = batch != nullptr ? batch : pDevice->beginUpload();
+    VulkanBase::StagingRegion vertexStaging = pDevice->stage(upload, vertexData, vertexBufferSize);
+    VulkanBase::StagingRegion indexStaging = pDevice->stage(upload, indexData, indexBufferSize);
 
     VkBufferCopy copyRegion{};
 
+    copyRegion.srcOffset = vertexStaging.offset;
+    copyRegion.dstOffset = vertexOffset;
     copyRegion.size = vertexBufferSize;
-    vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, vertexBuffer.buffer, 1, &copyRegion);
+    vkCmdCopyBuffer(upload->commandBuffer, vertexStaging.buffer, pool->vertexBuffer, 1, &copyRegion);
 
+    copyRegion.srcOffset = indexStaging.offset;
+    copyRegion.dstOffset = indexOffset;
     copyRegion.size = indexBufferSize;
-    vkCmdCopyBuffer(copyCmd, indexStaging.buffer, indexBuffer.buffer, 1, &copyRegion);
-
-    pDevice->flushCommandBuffer(copyCmd, pDevice->graphicsQueue, true);
+    vkCmdCopyBuffer(upload->commandBuffer, indexStaging.buffer, pool->indexBuffer, 1, &copyRegion);
 
-    vkDestroyBuffer(pDevice->logicalDevice, vertexStaging.buffer, nullptr);
-    vkFreeMemory(pDevice->logicalDevice, vertexStaging.memory, nullptr);
-    vkDestroyBuffer(pDevice->logicalDevice, indexStaging.buffer, nullptr);
-    vkFreeMemory(pDevice->logicalDevice, indexStaging.memory, nullptr);
+    pDevice->releaseBuffer(upload, pool->vertexBuffer, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                           vertexOffset, vertexBufferSize);
+    pDevice->releaseBuffer(upload, pool->indexBuffer, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                           indexOffset, indexBufferSize);
+    if (batch == nullptr) {
+        pDevice->submitUpload(upload);
+    }
 }
 
 std::array<VkVertexInputAttributeDescription, 4> Vertex::GetAttributeDescriptions() {
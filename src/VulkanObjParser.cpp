@@ -0,0 +1,334 @@
+#include "VulkanObjParser.h"
+#include "VulkanMeshCache.h"
+#include "VulkanVertexWelder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace VulkanBase {
+    namespace {
+        const size_t MIN_CHUNK_SIZE = 1024 * 1024;
+        const uint8_t RELATIVE_POSITION = 1;
+        const uint8_t RELATIVE_TEXCOORD = 2;
+        const uint8_t RELATIVE_NORMAL = 4;
+
+        // Attribute indices of a face corner, 0 based. Negative OBJ indices are stored relative to the start of their
+        // chunk and flagged, -1 without the flag means the attribute is missing
+        struct Corner {
+            int32_t position;
+            int32_t texCoord;
+            int32_t normal;
+            uint8_t relative;
+        };
+
+        struct Chunk {
+            const char *begin;
+            const char *end;
+            std::vector<float> positions;
+            std::vector<float> texCoords;
+            std::vector<float> normals;
+            // Three per triangle
+            std::vector<Corner> corners;
+            size_t positionOffset = 0;
+            size_t texCoordOffset = 0;
+            size_t normalOffset = 0;
+            size_t cornerOffset = 0;
+        };
+
+        const double POWERS_OF_TEN[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+        inline bool isSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        inline bool isDigit(char c) {
+            return c >= '0' && c <= '9';
+        }
+
+        inline const char *skipSpace(const char *p, const char *end) {
+            while (p < end && isSpace(*p)) {
+                p++;
+            }
+            return p;
+        }
+
+        // Decimal mantissa and exponent scaled by an exact power of ten, which rounds correctly for anything an OBJ
+        // exporter writes and is several times faster than strtod
+        const char *parseFloat(const char *p, const char *end, float &value) {
+            p = skipSpace(p, end);
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negative = *p == '-';
+                p++;
+            }
+            uint64_t mantissa = 0;
+            int32_t exponent = 0;
+            int32_t digits = 0;
+            for (; p < end && isDigit(*p); p++) {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                    digits += mantissa != 0;
+                } else {
+                    exponent++;
+                }
+            }
+            if (p < end && *p == '.') {
+                for (p++; p < end && isDigit(*p); p++) {
+                    if (digits < 19) {
+                        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                        digits += mantissa != 0;
+                        exponent--;
+                    }
+                }
+            }
+            if (p < end && (*p == 'e' || *p == 'E')) {
+                p++;
+                bool negativeExponent = false;
+                if (p < end && (*p == '-' || *p == '+')) {
+                    negativeExponent = *p == '-';
+                    p++;
+                }
+                int32_t e = 0;
+                for (; p < end && isDigit(*p); p++) {
+                    e = std::min(e * 10 + (*p - '0'), 1000);
+                }
+                exponent += negativeExponent ? -e : e;
+            }
+            double result = static_cast<double>(mantissa);
+            if (exponent < 0 && exponent >= -22) {
+                result /= POWERS_OF_TEN[-exponent];
+            } else if (exponent >= 0 && exponent <= 22) {
+                result *= POWERS_OF_TEN[exponent];
+            } else {
+                result *= std::pow(10.0, exponent);
+            }
+            value = static_cast<float>(negative ? -result : result);
+            return p;
+        }
+
+        inline const char *parseIndex(const char *p, const char *end, int32_t &value) {
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negative = *p == '-';
+                p++;
+            }
+            int32_t result = 0;
+            for (; p < end && isDigit(*p); p++) {
+                result = result * 10 + (*p - '0');
+            }
+            value = negative ? -result : result;
+            return p;
+        }
+
+        // OBJ indices are 1 based, negative ones count back from the attributes read so far
+        inline void resolveIndex(int32_t index, size_t localCount, uint8_t relativeFlag, int32_t &resolved, uint8_t &relative) {
+            if (index > 0) {
+                resolved = index - 1;
+            } else if (index < 0) {
+                resolved = static_cast<int32_t>(localCount) + index;
+                relative |= relativeFlag;
+            } else {
+                resolved = -1;
+            }
+        }
+
+        void parseChunk(Chunk &chunk) {
+            std::vector<Corner> polygon;
+            const char *p = chunk.begin;
+            while (p < chunk.end) {
+                const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', chunk.end - p));
+                if (lineEnd == nullptr) {
+                    lineEnd = chunk.end;
+                }
+                p = skipSpace(p, lineEnd);
+                if (lineEnd - p >= 2 && p[0] == 'v' && isSpace(p[1])) {
+                    float x, y, z;
+                    p = parseFloat(p + 1, lineEnd, x);
+                    p = parseFloat(p, lineEnd, y);
+                    parseFloat(p, lineEnd, z);
+                    chunk.positions.push_back(x);
+                    chunk.positions.push_back(y);
+                    chunk.positions.push_back(z);
+                } else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2])) {
+                    float u, v;
+                    p = parseFloat(p + 2, lineEnd, u);
+                    parseFloat(p, lineEnd, v);
+                    chunk.texCoords.push_back(u);
+                    chunk.texCoords.push_back(v);
+                } else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])) {
+                    float x, y, z;
+                    p = parseFloat(p + 2, lineEnd, x);
+                    p = parseFloat(p, lineEnd, y);
+                    parseFloat(p, lineEnd, z);
+                    chunk.normals.push_back(x);
+                    chunk.normals.push_back(y);
+                    chunk.normals.push_back(z);
+                } else if (lineEnd - p >= 2 && p[0] == 'f' && isSpace(p[1])) {
+                    polygon.clear();
+                    p = skipSpace(p + 1, lineEnd);
+                    while (p < lineEnd) {
+                        Corner corner{-1, -1, -1, 0};
+                        int32_t index;
+                        p = parseIndex(p, lineEnd, index);
+                        resolveIndex(index, chunk.positions.size() / 3, RELATIVE_POSITION, corner.position, corner.relative);
+                        if (p < lineEnd && *p == '/') {
+                            p++;
+                            if (p < lineEnd && *p != '/') {
+                                p = parseIndex(p, lineEnd, index);
+                                resolveIndex(index, chunk.texCoords.size() / 2, RELATIVE_TEXCOORD, corner.texCoord, corner.relative);
+                            }
+                            if (p < lineEnd && *p == '/') {
+                                p = parseIndex(p + 1, lineEnd, index);
+                                resolveIndex(index, chunk.normals.size() / 3, RELATIVE_NORMAL, corner.normal, corner.relative);
+                            }
+                        }
+                        polygon.push_back(corner);
+                        while (p < lineEnd && !isSpace(*p)) {
+                            p++;
+                        }
+                        p = skipSpace(p, lineEnd);
+                    }
+                    // Fan split, the same one tinyobj makes
+                    for (size_t k = 2; k < polygon.size(); k++) {
+                        chunk.corners.push_back(polygon[0]);
+                        chunk.corners.push_back(polygon[k - 1]);
+                        chunk.corners.push_back(polygon[k]);
+                    }
+                }
+                p = lineEnd + 1;
+            }
+        }
+
+        inline int64_t globalIndex(int32_t index, bool relative, size_t chunkOffset, size_t count, const char *attribute) {
+            int64_t resolved = relative ? static_cast<int64_t>(chunkOffset) + index : index;
+            if (resolved >= static_cast<int64_t>(count) || resolved < -1 || (resolved == -1 && relative)) {
+                throw std::runtime_error(std::string("failed to load model: ") + attribute + " index out of range");
+            }
+            return resolved;
+        }
+    }
+
+    namespace ObjParser {
+        void load(const std::string &filePath, ThreadPool *threadPool, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+            MappedFile file;
+            if (!file.open(filePath)) {
+                throw std::runtime_error("failed to load model: " + filePath);
+            }
+            const char *data = file.data();
+            size_t size = file.size();
+
+            // Chunk boundaries move forward to the next line start so no record is split
+            size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadPool->size() * 4, size / MIN_CHUNK_SIZE));
+            std::vector<Chunk> chunks(chunkCount);
+            size_t begin = 0;
+            for (size_t i = 0; i < chunkCount; i++) {
+                size_t end = i + 1 == chunkCount ? size : std::max(begin, size * (i + 1) / chunkCount);
+                const void *newline = end < size ? std::memchr(data + end, '\n', size - end) : nullptr;
+                end = newline != nullptr ? static_cast<const char *>(newline) - data + 1 : size;
+                chunks[i].begin = data + begin;
+                chunks[i].end = data + end;
+                begin = end;
+            }
+
+            threadPool->parallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t taskIndex, uint32_t) {
+                parseChunk(chunks[taskIndex]);
+            });
+
+            size_t positionCount = 0;
+            size_t texCoordCount = 0;
+            size_t normalCount = 0;
+            size_t cornerCount = 0;
+            for (auto &chunk : chunks) {
+                chunk.positionOffset = positionCount;
+                chunk.texCoordOffset = texCoordCount;
+                chunk.normalOffset = normalCount;
+                chunk.cornerOffset = cornerCount;
+                positionCount += chunk.positions.size() / 3;
+                texCoordCount += chunk.texCoords.size() / 2;
+                normalCount += chunk.normals.size() / 3;
+                cornerCount += chunk.corners.size();
+            }
+
+            std::vector<float> positions(positionCount * 3);
+            std::vector<float> texCoords(texCoordCount * 2);
+            std::vector<float> normals(normalCount * 3);
+            threadPool->parallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t taskIndex, uint32_t) {
+                Chunk &chunk = chunks[taskIndex];
+                std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionOffset * 3);
+                std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunk.texCoordOffset * 2);
+                std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalOffset * 3);
+                std::vector<float>().swap(chunk.positions);
+                std::vector<float>().swap(chunk.texCoords);
+                std::vector<float>().swap(chunk.normals);
+            });
+
+            // One vertex per corner with its weld hash, built per chunk
+            std::vector<Vertex> corners(cornerCount);
+            std::vector<uint32_t> hashes(cornerCount);
+            threadPool->parallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t taskIndex, uint32_t) {
+                Chunk &chunk = chunks[taskIndex];
+                for (size_t i = 0; i < chunk.corners.size(); i++) {
+                    const Corner &corner = chunk.corners[i];
+                    Vertex &vertex = corners[chunk.cornerOffset + i];
+                    int64_t position = globalIndex(corner.position, (corner.relative & RELATIVE_POSITION) != 0, chunk.positionOffset,
+                                                   positionCount, "position");
+                    int64_t texCoord = globalIndex(corner.texCoord, (corner.relative & RELATIVE_TEXCOORD) != 0, chunk.texCoordOffset,
+                                                   texCoordCount, "texcoord");
+                    int64_t normal = globalIndex(corner.normal, (corner.relative & RELATIVE_NORMAL) != 0, chunk.normalOffset,
+                                                 normalCount, "normal");
+                    if (position < 0) {
+                        throw std::runtime_error("failed to load model: face corner without position");
+                    }
+                    vertex.pos = glm::vec3(positions[position * 3 + 0], positions[position * 3 + 1], positions[position * 3 + 2]);
+                    if (texCoord >= 0) {
+                        vertex.texCoord = glm::vec2(texCoords[texCoord * 2 + 0], 1.0f - texCoords[texCoord * 2 + 1]);
+                    }
+                    if (normal >= 0) {
+                        vertex.normal = glm::vec3(normals[normal * 3 + 0], normals[normal * 3 + 1], normals[normal * 3 + 2]);
+                    }
+                    hashes[chunk.cornerOffset + i] = VertexWelder::hash(vertex);
+                }
+                std::vector<Corner>().swap(chunk.corners);
+            });
+
+            // Each task welds the corners whose hash falls in its partition, equal corners always share one. The result
+            // is the first corner equal to each corner
+            uint32_t partitionCount = threadPool->size();
+            std::vector<uint32_t> firstCorners(cornerCount);
+            threadPool->parallelFor(partitionCount, [&](uint32_t taskIndex, uint32_t) {
+                std::vector<Vertex> unique;
+                std::vector<uint32_t> uniqueCorners;
+                VertexWelder welder(unique, positionCount / partitionCount + 1);
+                for (size_t i = 0; i < cornerCount; i++) {
+                    if ((static_cast<uint64_t>(hashes[i]) * partitionCount) >> 32 != taskIndex) {
+                        continue;
+                    }
+                    uint32_t index = welder.weld(corners[i]);
+                    if (index == uniqueCorners.size()) {
+                        uniqueCorners.push_back(static_cast<uint32_t>(i));
+                    }
+                    firstCorners[i] = uniqueCorners[index];
+                }
+            });
+
+            // Numbering in first use order matches welding the corners one after another
+            std::vector<uint32_t> cornerVertices(cornerCount);
+            size_t uniqueCount = 0;
+            for (size_t i = 0; i < cornerCount; i++) {
+                uniqueCount += firstCorners[i] == i;
+            }
+            vertices.reserve(vertices.size() + uniqueCount);
+            indices.reserve(indices.size() + cornerCount);
+            for (size_t i = 0; i < cornerCount; i++) {
+                if (firstCorners[i] == i) {
+                    cornerVertices[i] = static_cast<uint32_t>(vertices.size());
+                    vertices.push_back(corners[i]);
+                }
+                indices.push_back(cornerVertices[firstCorners[i]]);
+            }
+        }
+    }
+}
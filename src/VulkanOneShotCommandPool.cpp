@@ -0,0 +1,60 @@
+#include "VulkanOneShotCommandPool.h"
+#include "VulkanTools.h"
+
+#include <cassert>
+#include <iostream>
+
+namespace VulkanBase {
+    OneShotCommandPool::OneShotCommandPool(VkDevice logicalDevice, uint32_t queueFamilyIndex)
+            : logicalDevice(logicalDevice), queueFamilyIndex(queueFamilyIndex) {
+    }
+
+    OneShotCommandPool::~OneShotCommandPool() {
+        // Destroying a pool frees every buffer allocated from it
+        for (auto &threadPool : threadPools) {
+            vkDestroyCommandPool(logicalDevice, threadPool.second->pool, nullptr);
+            delete threadPool.second;
+        }
+    }
+
+    VkCommandBuffer OneShotCommandPool::acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ThreadPool *&threadPool = threadPools[std::this_thread::get_id()];
+        if (threadPool == nullptr) {
+            threadPool = new ThreadPool();
+            VkCommandPoolCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+            createInfo.queueFamilyIndex = queueFamilyIndex;
+            VK_CHECK_RESULT(vkCreateCommandPool(logicalDevice, &createInfo, nullptr, &threadPool->pool));
+        }
+        if (!threadPool->freeBuffers.empty()) {
+            VkCommandBuffer commandBuffer = threadPool->freeBuffers.back();
+            threadPool->freeBuffers.pop_back();
+            return commandBuffer;
+        }
+
+        VkCommandBufferAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = threadPool->pool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        VK_CHECK_RESULT(vkAllocateCommandBuffers(logicalDevice, &allocateInfo, &commandBuffer));
+        owners[commandBuffer] = threadPool;
+        return commandBuffer;
+    }
+
+    void OneShotCommandPool::recycle(VkCommandBuffer commandBuffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto owner = owners.find(commandBuffer);
+        assert(owner != owners.end());
+        // The reset happens on the owning thread when the buffer is begun again
+        owner->second->freeBuffers.push_back(commandBuffer);
+    }
+
+    bool OneShotCommandPool::owns(VkCommandBuffer commandBuffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return owners.find(commandBuffer) != owners.end();
+    }
+}
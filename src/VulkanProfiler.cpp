@@ -0,0 +1,278 @@
+#include "VulkanProfiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "imgui.h"
+
+namespace VulkanBase {
+    RollingHistory::RollingHistory(size_t capacity) : capacity(capacity) {
+        values.reserve(capacity);
+        sorted.reserve(capacity);
+    }
+
+    void RollingHistory::push(double value) {
+        if (values.size() < capacity) {
+            values.push_back(value);
+        } else {
+            values[next] = value;
+        }
+        next = (next + 1) % capacity;
+    }
+
+    TimingStatistics RollingHistory::statistics() const {
+        TimingStatistics stats;
+        stats.samples = values.size();
+        if (values.empty()) {
+            return stats;
+        }
+        sorted.assign(values.begin(), values.end());
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double value : sorted) {
+            sum += value;
+        }
+        // Nearest-rank percentiles
+        auto percentile = [this](double p) {
+            size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+            return sorted[std::max<size_t>(rank, 1) - 1];
+        };
+        stats.min = sorted.front();
+        stats.avg = sum / sorted.size();
+        stats.p95 = percentile(0.95);
+        stats.p99 = percentile(0.99);
+        return stats;
+    }
+
+    FrameProfiler::CpuScope::CpuScope(FrameProfiler &profiler, CpuPhase phase) : profiler(profiler), phase(phase), start(std::chrono::steady_clock::now()) {}
+
+    FrameProfiler::CpuScope::~CpuScope() {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        profiler.addCpuTime(phase, elapsed.count());
+    }
+
+    void FrameProfiler::init(VulkanDevice *device, uint32_t frameCount, size_t history) {
+        logicalDevice = device->logicalDevice;
+        historySize = history;
+        cpuHistories.assign(static_cast<size_t>(CpuPhase::Count), RollingHistory(historySize));
+        frameHistory = RollingHistory(historySize);
+
+        uint32_t validBits = device->queueFamilyProperties[device->queueIndices.graphicsIdx].timestampValidBits;
+        gpuTimingSupported = validBits > 0 && device->properties.limits.timestampPeriod > 0.0f;
+        if (!gpuTimingSupported) {
+            std::cout << "Timestamp queries are not supported on the graphics queue, GPU timing is disabled." << std::endl;
+            return;
+        }
+        timestampPeriod = device->properties.limits.timestampPeriod;
+        timestampMask = validBits >= 64 ? ~0ULL : ((1ULL << validBits) - 1);
+
+        gpuFrames.resize(frameCount);
+        VkQueryPoolCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        createInfo.queryCount = MAX_GPU_SCOPES * 2;
+        for (auto &frame : gpuFrames) {
+            VK_CHECK_RESULT(vkCreateQueryPool(logicalDevice, &createInfo, nullptr, &frame.queryPool));
+        }
+    }
+
+    void FrameProfiler::destroy() {
+        for (auto &frame : gpuFrames) {
+            vkDestroyQueryPool(logicalDevice, frame.queryPool, nullptr);
+        }
+        gpuFrames.clear();
+    }
+
+    void FrameProfiler::beginFrame() {
+        auto now = std::chrono::steady_clock::now();
+        if (frameStarted) {
+            std::chrono::duration<double, std::milli> elapsed = now - frameStart;
+            frameHistory.push(elapsed.count());
+            for (size_t i = 0; i < currentCpuTimes.size(); i++) {
+                cpuHistories[i].push(currentCpuTimes[i]);
+            }
+        }
+        currentCpuTimes.fill(0.0);
+        frameStart = now;
+        frameStarted = true;
+    }
+
+    void FrameProfiler::discardFrame() {
+        currentCpuTimes.fill(0.0);
+        frameStarted = false;
+    }
+
+    void FrameProfiler::addCpuTime(CpuPhase phase, double milliseconds) {
+        currentCpuTimes[static_cast<size_t>(phase)] += milliseconds;
+    }
+
+    void FrameProfiler::addLatency(const std::string &name, double milliseconds) {
+        auto it = latencyHistories.find(name);
+        if (it == latencyHistories.end()) {
+            it = latencyHistories.insert(std::make_pair(name, RollingHistory(historySize))).first;
+        }
+        it->second.push(milliseconds);
+    }
+
+    void FrameProfiler::collectGpuResults(uint32_t frameIndex) {
+        if (!gpuTimingSupported) {
+            return;
+        }
+        // Only called once the frame's submission has retired, so every written query is available
+        GpuFrame &frame = gpuFrames[frameIndex];
+        if (frame.queryCount == 0) {
+            return;
+        }
+        std::array<uint64_t, MAX_GPU_SCOPES * 2> timestamps;
+        VK_CHECK_RESULT(vkGetQueryPoolResults(logicalDevice, frame.queryPool, 0, frame.queryCount, frame.queryCount * sizeof(uint64_t),
+                                              timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+        for (uint32_t i = 0; i < frame.scopeNames.size(); i++) {
+            uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & timestampMask;
+            auto it = gpuHistories.find(frame.scopeNames[i]);
+            if (it == gpuHistories.end()) {
+                it = gpuHistories.insert(std::make_pair(frame.scopeNames[i], RollingHistory(historySize))).first;
+            }
+            it->second.push(ticks * timestampPeriod / 1000000.0);
+        }
+        frame.queryCount = 0;
+        frame.scopeNames.clear();
+    }
+
+    void FrameProfiler::resetQueries(VkCommandBuffer cmdBuffer, uint32_t frameIndex) {
+        if (!gpuTimingSupported) {
+            return;
+        }
+        GpuFrame &frame = gpuFrames[frameIndex];
+        vkCmdResetQueryPool(cmdBuffer, frame.queryPool, 0, MAX_GPU_SCOPES * 2);
+        frame.queryCount = 0;
+        frame.scopeNames.clear();
+        frame.openScopes.clear();
+    }
+
+    void FrameProfiler::beginGpuScope(VkCommandBuffer cmdBuffer, uint32_t frameIndex, const std::string &name) {
+        if (!gpuTimingSupported) {
+            return;
+        }
+        GpuFrame &frame = gpuFrames[frameIndex];
+        assert(frame.scopeNames.size() < MAX_GPU_SCOPES);
+        uint32_t scope = static_cast<uint32_t>(frame.scopeNames.size());
+        frame.scopeNames.push_back(name);
+        frame.openScopes.push_back(scope);
+        vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, scope * 2);
+    }
+
+    void FrameProfiler::endGpuScope(VkCommandBuffer cmdBuffer, uint32_t frameIndex) {
+        if (!gpuTimingSupported) {
+            return;
+        }
+        GpuFrame &frame = gpuFrames[frameIndex];
+        assert(!frame.openScopes.empty());
+        uint32_t scope = frame.openScopes.back();
+        frame.openScopes.pop_back();
+        vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.queryPool, scope * 2 + 1);
+        frame.queryCount = std::max(frame.queryCount, scope * 2 + 2);
+    }
+
+    const char *FrameProfiler::phaseName(CpuPhase phase) {
+        switch (phase) {
+            case CpuPhase::FrameWait: return "Frame Wait";
+            case CpuPhase::Acquire: return "Acquire";
+            case CpuPhase::Record: return "Record";
+            case CpuPhase::UniformUpdate: return "Uniform Update";
+            case CpuPhase::Submit: return "Submit";
+            case CpuPhase::Present: return "Present";
+            default: return "Unknown";
+        }
+    }
+
+    static void statisticsRow(const char *name, const TimingStatistics &stats) {
+        ImGui::Text("%-16s %7.3f %7.3f %7.3f %7.3f", name, stats.min, stats.avg, stats.p95, stats.p99);
+    }
+
+    void FrameProfiler::drawPanel() {
+        ImGui::Begin("Profiler");
+        ImGui::Text("%-16s %7s %7s %7s %7s", "ms", "min", "avg", "p95", "p99");
+        statisticsRow("Frame", frameHistory.statistics());
+        if (ImGui::CollapsingHeader("CPU", ImGuiTreeNodeFlags_DefaultOpen)) {
+            for (size_t i = 0; i < cpuHistories.size(); i++) {
+                statisticsRow(phaseName(static_cast<CpuPhase>(i)), cpuHistories[i].statistics());
+            }
+        }
+        if (gpuTimingSupported && ImGui::CollapsingHeader("GPU", ImGuiTreeNodeFlags_DefaultOpen)) {
+            for (const auto &history : gpuHistories) {
+                statisticsRow(history.first.c_str(), history.second.statistics());
+            }
+        }
+        if (!latencyHistories.empty() && ImGui::CollapsingHeader("Latency", ImGuiTreeNodeFlags_DefaultOpen)) {
+            for (const auto &history : latencyHistories) {
+                statisticsRow(history.first.c_str(), history.second.statistics());
+            }
+        }
+        if (ImGui::Button("Export")) {
+            exportCSV("profile.csv");
+            exportJSON("profile.json");
+        }
+        ImGui::End();
+    }
+
+    bool FrameProfiler::exportCSV(const std::string &filePath) const {
+        std::ofstream file(filePath);
+        if (!file.is_open()) {
+            std::cout << "failed to open file: " << filePath << std::endl;
+            return false;
+        }
+        auto writeRow = [&file](const char *category, const std::string &name, const TimingStatistics &stats) {
+            file << category << "," << name << "," << stats.min << "," << stats.avg << "," << stats.p95 << "," << stats.p99 << "," << stats.samples << "\n";
+        };
+        file << "category,name,min_ms,avg_ms,p95_ms,p99_ms,samples\n";
+        writeRow("frame", "Frame", frameHistory.statistics());
+        for (size_t i = 0; i < cpuHistories.size(); i++) {
+            writeRow("cpu", phaseName(static_cast<CpuPhase>(i)), cpuHistories[i].statistics());
+        }
+        for (const auto &history : gpuHistories) {
+            writeRow("gpu", history.first, history.second.statistics());
+        }
+        for (const auto &history : latencyHistories) {
+            writeRow("latency", history.first, history.second.statistics());
+        }
+        return true;
+    }
+
+    bool FrameProfiler::exportJSON(const std::string &filePath) const {
+        std::ofstream file(filePath);
+        if (!file.is_open()) {
+            std::cout << "failed to open file: " << filePath << std::endl;
+            return false;
+        }
+        auto writeEntry = [&file](const std::string &name, const TimingStatistics &stats) {
+            file << "\"" << name << "\": {\"min\": " << stats.min << ", \"avg\": " << stats.avg << ", \"p95\": " << stats.p95
+                 << ", \"p99\": " << stats.p99 << ", \"samples\": " << stats.samples << "}";
+        };
+        file << "{\n  ";
+        writeEntry("frame", frameHistory.statistics());
+        file << ",\n  \"cpu\": {";
+        for (size_t i = 0; i < cpuHistories.size(); i++) {
+            file << (i == 0 ? "\n    " : ",\n    ");
+            writeEntry(phaseName(static_cast<CpuPhase>(i)), cpuHistories[i].statistics());
+        }
+        file << "\n  },\n  \"gpu\": {";
+        bool first = true;
+        for (const auto &history : gpuHistories) {
+            file << (first ? "\n    " : ",\n    ");
+            writeEntry(history.first, history.second.statistics());
+            first = false;
+        }
+        file << "\n  },\n  \"latency\": {";
+        first = true;
+        for (const auto &history : latencyHistories) {
+            file << (first ? "\n    " : ",\n    ");
+            writeEntry(history.first, history.second.statistics());
+            first = false;
+        }
+        file << "\n  }\n}\n";
+        return true;
+    }
+}
@@ -9,19 +9,7 @@ VulkanBase::RayTracingScratchBuffer::RayTracingScratchBuffer(VulkanDevice &devic
     bufferCreateInfo.size = deviceSize;
     bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
     VK_CHECK_RESULT(vkCreateBuffer(device.logicalDevice, &bufferCreateInfo, nullptr, &buffer));
-
-    VkMemoryRequirements memoryRequirements{};
-    vkGetBufferMemoryRequirements(device.logicalDevice, buffer, &memoryRequirements);
-    VkMemoryAllocateFlagsInfo flagsInfo{};
-    flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
-    flagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
-    VkMemoryAllocateInfo allocateInfo{};
-    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocateInfo.memoryTypeIndex = device.getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    allocateInfo.allocationSize = memoryRequirements.size;
-    allocateInfo.pNext = &flagsInfo;
-    VK_CHECK_RESULT(vkAllocateMemory(device.logicalDevice, &allocateInfo, nullptr, &memory));
-    VK_CHECK_RESULT(vkBindBufferMemory(device.logicalDevice, buffer, memory, 0));
+    allocation = device.allocator->allocateBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
 
     VkBufferDeviceAddressInfoKHR addressInfo{};
     addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
@@ -30,9 +18,7 @@ VulkanBase::RayTracingScratchBuffer::RayTracingScratchBuffer(VulkanDevice &devic
 }
 
 void VulkanBase::RayTracingScratchBuffer::cleanUp() {
-    if (memory != VK_NULL_HANDLE) {
-        vkFreeMemory(device.logicalDevice, memory, nullptr);
-    }
+    device.allocator->free(allocation);
     if (buffer != VK_NULL_HANDLE) {
         vkDestroyBuffer(device.logicalDevice, buffer, nullptr);
     }
@@ -45,21 +31,7 @@ VulkanBase::AccelerationStructure::AccelerationStructure(VulkanDevice &device, V
     bufferCreateInfo.size = buildSizesInfo.accelerationStructureSize;
     bufferCreateInfo.usage = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
     VK_CHECK_RESULT(vkCreateBuffer(device.logicalDevice, &bufferCreateInfo, nullptr, &buffer));
-
-    VkMemoryRequirements memoryRequirements{};
-    vkGetBufferMemoryRequirements(device.logicalDevice, buffer, &memoryRequirements);
-
-    VkMemoryAllocateFlagsInfo allocateFlagsInfo{};
-    allocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
-    allocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
-
-    VkMemoryAllocateInfo allocateInfo{};
-    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocateInfo.pNext = &allocateFlagsInfo;
-    allocateInfo.allocationSize = memoryRequirements.size;
-    allocateInfo.memoryTypeIndex = device.getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    VK_CHECK_RESULT(vkAllocateMemory(device.logicalDevice, &allocateInfo, nullptr, &memory));
-    VK_CHECK_RESULT(vkBindBufferMemory(device.logicalDevice, buffer, memory, 0));
+    allocation = device.allocator->allocateBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
 
     VkAccelerationStructureCreateInfoKHR structureCreateInfo{};
     structureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
@@ -75,8 +47,8 @@ VulkanBase::AccelerationStructure::AccelerationStructure(VulkanDevice &device, V
 }
 
 void VulkanBase::AccelerationStructure::cleanUp() {
-    vkFreeMemory(device.logicalDevice, memory, nullptr);
     vkDestroyBuffer(device.logicalDevice, buffer, nullptr);
+    device.allocator->free(allocation);
     vkDestroyAccelerationStructureKHR(device.logicalDevice, handle, nullptr);
 }
 
@@ -110,7 +82,7 @@ void VulkanBase::VulkanRayTracingApplicationBase::createStorageImage(VkFormat fo
     if (storageImage.image != VK_NULL_HANDLE) {
         vkDestroyImageView(vulkanDevice->logicalDevice, storageImage.view, nullptr);
         vkDestroyImage(vulkanDevice->logicalDevice, storageImage.image, nullptr);
-        vkFreeMemory(vulkanDevice->logicalDevice, storageImage.memory, nullptr);
+        vulkanDevice->allocator->free(storageImage.allocation);
         storageImage = {};
     }
     VkImageCreateInfo imageCreateInfo{};
@@ -125,15 +97,8 @@ void VulkanBase::VulkanRayTracingApplicationBase::createStorageImage(VkFormat fo
     imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
     imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     VK_CHECK_RESULT(vkCreateImage(vulkanDevice->logicalDevice, &imageCreateInfo, nullptr, &storageImage.image));
-
-    VkMemoryRequirements memReqs;
-    vkGetImageMemoryRequirements(vulkanDevice->logicalDevice, storageImage.image, &memReqs);
-    VkMemoryAllocateInfo memoryAllocateInfo{};
-    memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memoryAllocateInfo.allocationSize = memReqs.size;
-    memoryAllocateInfo.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    VK_CHECK_RESULT(vkAllocateMemory(vulkanDevice->logicalDevice, &memoryAllocateInfo, nullptr, &storageImage.memory));
-    VK_CHECK_RESULT(vkBindImageMemory(vulkanDevice->logicalDevice, storageImage.image, storageImage.memory, 0));
+    storageImage.allocation = vulkanDevice->allocator->allocateImage(storageImage.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false,
+                                                                     VulkanBase::MemoryCategory::RenderTarget);
 
     VkImageViewCreateInfo colorImageView{};
     colorImageView.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -159,7 +124,7 @@ void VulkanBase::VulkanRayTracingApplicationBase::createStorageImage(VkFormat fo
 void VulkanBase::VulkanRayTracingApplicationBase::cleanUpStorageImage() {
     vkDestroyImageView(vulkanDevice->logicalDevice, storageImage.view, nullptr);
     vkDestroyImage(vulkanDevice->logicalDevice, storageImage.image, nullptr);
-    vkFreeMemory(vulkanDevice->logicalDevice, storageImage.memory, nullptr);
+    vulkanDevice->allocator->free(storageImage.allocation);
 }
 
 uint64_t VulkanBase::VulkanRayTracingApplicationBase::getBufferDeviceAddress(VkBuffer buffer) {
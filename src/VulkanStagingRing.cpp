@@ -0,0 +1,87 @@
+#include "VulkanStagingRing.h"
+#include "VulkanTools.h"
+
+#include <cassert>
+#include <iostream>
+
+namespace VulkanBase {
+    StagingRing::StagingRing(VkDevice logicalDevice, MemoryAllocator *allocator, VkDeviceSize size)
+            : logicalDevice(logicalDevice), allocator(allocator), size(size) {
+        VkBufferCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.size = size;
+        createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &createInfo, nullptr, &buffer));
+        allocation = allocator->allocateBuffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, false,
+                                               MemoryCategory::Staging);
+    }
+
+    StagingRing::~StagingRing() {
+        vkDestroyBuffer(logicalDevice, buffer, nullptr);
+        allocator->free(allocation);
+    }
+
+    bool StagingRing::allocate(VkDeviceSize regionSize, VkDeviceSize alignment, const void *owner, StagingRegion &region) {
+        if (regionSize > size) {
+            return false;
+        }
+        if (used == 0) {
+            head = 0;
+            tail = 0;
+        }
+        VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+        VkDeviceSize consumed;
+        if (used == 0 || head > tail) {
+            // Free space runs from the head to the end and wraps around up to the tail
+            if (offset + regionSize <= size) {
+                consumed = offset + regionSize - head;
+            } else if (regionSize <= tail) {
+                consumed = size - head + regionSize;
+                offset = 0;
+            } else {
+                return false;
+            }
+        } else if (head < tail && offset + regionSize <= tail) {
+            consumed = offset + regionSize - head;
+        } else {
+            return false;
+        }
+
+        head = offset + regionSize;
+        used += consumed;
+        spans.push_back({head, consumed, owner, 0});
+
+        region.buffer = buffer;
+        region.offset = offset;
+        region.size = regionSize;
+        region.mapped = static_cast<char *>(allocation.mapped) + offset;
+        return true;
+    }
+
+    void StagingRing::submit(const void *owner, uint64_t value) {
+        for (auto &span : spans) {
+            if (span.owner == owner && span.value == 0) {
+                span.value = value;
+            }
+        }
+    }
+
+    uint64_t StagingRing::oldestValue() const {
+        return spans.empty() ? 0 : spans.front().value;
+    }
+
+    void StagingRing::releaseOldest() {
+        assert(!spans.empty() && spans.front().value != 0);
+        uint64_t value = spans.front().value;
+        while (!spans.empty() && spans.front().value == value) {
+            tail = spans.front().end;
+            used -= spans.front().bytes;
+            spans.pop_front();
+        }
+    }
+
+    VkDeviceSize StagingRing::capacity() const {
+        return size;
+    }
+}
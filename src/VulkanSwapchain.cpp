@@ -7,7 +7,7 @@
 namespace VulkanBase {
     VulkanSwapchain::VulkanSwapchain(QueueIndices _queueIndices, VkPhysicalDevice _physicalDevice, VkDevice _device, VkSurfaceKHR _surface) : queueIndices(_queueIndices), physicalDevice(_physicalDevice), logicalDevice(_device), surface(_surface) {
         initSurface();
-
+        vkWaitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(logicalDevice, "vkWaitForPresentKHR"));
     }
 
     void VulkanSwapchain::initSurface() {
@@ -29,7 +29,7 @@ namespace VulkanBase {
         colorSpace = selectedFormat.colorSpace;
         }
 
-    void VulkanSwapchain::createSwapchain(uint32_t *width, uint32_t *height) {
+    void VulkanSwapchain::createSwapchain(uint32_t *width, uint32_t *height, RetiredSwapchain *retired) {
         VkSwapchainKHR oldSwapchain = swapchain;
         VkSurfaceCapabilitiesKHR surfaceCapabilities;
         vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities);
@@ -41,14 +41,24 @@ namespace VulkanBase {
         }
         std::vector<VkPresentModeKHR> presentModes(presentModeCount);
         vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, presentModes.data());
+        // FIFO is the only mode every implementation supports
         VkPresentModeKHR selectedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
-        for (const auto &presentMode: presentModes) {
-            if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                selectedPresentMode = presentMode;
-                break;
+        if (presentPolicy == PresentPolicy::LowLatency) {
+            for (const auto &presentMode: presentModes) {
+                if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+                    selectedPresentMode = presentMode;
+                    break;
+                }
+                if (presentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+                    selectedPresentMode = presentMode;
+                }
             }
-            if (presentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-                selectedPresentMode = presentMode;
+        } else if (presentPolicy == PresentPolicy::PowerSaving) {
+            // Below the refresh rate a frame that misses its vblank is shown right away instead of waiting a whole interval
+            for (const auto &presentMode: presentModes) {
+                if (presentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR) {
+                    selectedPresentMode = presentMode;
+                }
             }
         }
 
@@ -65,7 +75,7 @@ namespace VulkanBase {
             *height = surfaceCapabilities.currentExtent.height;
         }
 
-        uint32_t swapchainImages = surfaceCapabilities.minImageCount + 1;
+        uint32_t swapchainImages = surfaceCapabilities.minImageCount + (presentPolicy == PresentPolicy::PowerSaving ? 0 : 1);
         // which means minImageCount + 1 is bigger than maxImageCount
         if (surfaceCapabilities.maxImageCount > 0 && swapchainImages > surfaceCapabilities.maxImageCount) {
             swapchainImages = surfaceCapabilities.maxImageCount;
@@ -100,10 +110,17 @@ namespace VulkanBase {
         VK_CHECK_RESULT(vkCreateSwapchainKHR(logicalDevice, &createInfo, nullptr, &swapchain));
 
         if (oldSwapchain != VK_NULL_HANDLE) {
+            RetiredSwapchain oldHandles;
+            oldHandles.swapchain = oldSwapchain;
             for (auto &swapchainBuffer: swapchainBuffers) {
-                vkDestroyImageView(logicalDevice, swapchainBuffer.imageView, nullptr);
+                oldHandles.imageViews.push_back(swapchainBuffer.imageView);
+            }
+            // Without a caller to defer destruction the old handles go away immediately
+            if (retired != nullptr) {
+                *retired = oldHandles;
+            } else {
+                destroyRetired(oldHandles);
             }
-            vkDestroySwapchainKHR(logicalDevice, oldSwapchain, nullptr);
         }
 
         vkGetSwapchainImagesKHR(logicalDevice, swapchain, &imageCount, nullptr);
@@ -136,14 +153,33 @@ namespace VulkanBase {
         }
     }
 
+    void VulkanSwapchain::destroyRetired(const RetiredSwapchain &retired) const {
+        for (auto &imageView : retired.imageViews) {
+            vkDestroyImageView(logicalDevice, imageView, nullptr);
+        }
+        vkDestroySwapchainKHR(logicalDevice, retired.swapchain, nullptr);
+    }
+
     VkResult VulkanSwapchain::acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t *imageIndex) {
         return vkAcquireNextImageKHR(logicalDevice, swapchain,UINT64_MAX, presentCompleteSemaphore, VK_NULL_HANDLE, imageIndex);
     }
 
-    VkResult VulkanSwapchain::queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore) {
+    VkResult VulkanSwapchain::queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore, uint64_t *presentId) {
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.pNext = nullptr;
+        // Ids only have to increase per swapchain, one counter across recreations satisfies every swapchain
+        uint64_t id = presentWaitSupported ? ++lastPresentId : 0;
+        VkPresentIdKHR presentIdInfo{};
+        presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        presentIdInfo.swapchainCount = 1;
+        presentIdInfo.pPresentIds = &id;
+        if (presentWaitSupported) {
+            presentInfo.pNext = &presentIdInfo;
+        }
+        if (presentId != nullptr) {
+            *presentId = id;
+        }
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = &swapchain;
         presentInfo.pImageIndices = &imageIndex;
@@ -154,6 +190,10 @@ namespace VulkanBase {
         return vkQueuePresentKHR(queue, &presentInfo);
     }
 
+    VkResult VulkanSwapchain::waitForPresent(uint64_t presentId, uint64_t timeout) {
+        return vkWaitForPresent(logicalDevice, swapchain, presentId, timeout);
+    }
+
     VulkanSwapchain::~VulkanSwapchain() {
         for (auto& buffer : swapchainBuffers) {
             vkDestroyImageView(logicalDevice, buffer.imageView, nullptr);
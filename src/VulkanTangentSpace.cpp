@@ -0,0 +1,142 @@
+#include "VulkanTangentSpace.h"
+#include "VulkanVertexWelder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace VulkanBase {
+    namespace {
+        const uint32_t INVALID_VERTEX = ~0u;
+
+        // Any unit vector perpendicular to normal, for vertices whose faces carry no usable UV gradient
+        glm::vec3 perpendicular(const glm::vec3 &normal) {
+            glm::vec3 axis = std::fabs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            return glm::normalize(glm::cross(normal, axis));
+        }
+
+        float cornerAngle(const glm::vec3 &a, const glm::vec3 &b) {
+            float lengths = glm::length(a) * glm::length(b);
+            if (lengths <= 0.0f) {
+                return 0.0f;
+            }
+            return std::acos(std::max(-1.0f, std::min(1.0f, glm::dot(a, b) / lengths)));
+        }
+    }
+
+    namespace TangentSpace {
+        void generateNormals(std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) {
+            bool missing = false;
+            for (const auto &vertex : vertices) {
+                missing |= glm::dot(vertex.normal, vertex.normal) == 0.0f;
+            }
+            if (!missing) {
+                return;
+            }
+
+            // Group vertices by position alone, the welder treats a vertex with only pos set as its position
+            std::vector<Vertex> positions;
+            std::vector<uint32_t> groups(vertices.size());
+            VertexWelder welder(positions, vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++) {
+                Vertex key{};
+                key.pos = vertices[i].pos;
+                groups[i] = welder.weld(key);
+            }
+
+            std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f));
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                const glm::vec3 &p0 = vertices[indices[i + 0]].pos;
+                const glm::vec3 &p1 = vertices[indices[i + 1]].pos;
+                const glm::vec3 &p2 = vertices[indices[i + 2]].pos;
+                // Length is twice the area, so larger faces weigh more
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                for (uint32_t k = 0; k < 3; k++) {
+                    normals[groups[indices[i + k]]] += normal;
+                }
+            }
+            for (size_t i = 0; i < vertices.size(); i++) {
+                if (glm::dot(vertices[i].normal, vertices[i].normal) != 0.0f) {
+                    continue;
+                }
+                float length = glm::length(normals[groups[i]]);
+                vertices[i].normal = length > 0.0f ? normals[groups[i]] / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            }
+        }
+
+        void generateTangents(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+            size_t vertexCount = vertices.size();
+            // Accumulated per vertex and handedness, index vertex * 2 + 1 collects the mirrored faces
+            std::vector<glm::vec3> tangents(vertexCount * 2, glm::vec3(0.0f));
+            std::vector<bool> used(vertexCount * 2, false);
+            std::vector<bool> mirrored(indices.size(), false);
+
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                glm::vec3 p[3];
+                glm::vec2 uv[3];
+                for (uint32_t k = 0; k < 3; k++) {
+                    const Vertex &vertex = vertices[indices[i + k]];
+                    p[k] = vertex.pos;
+                    // Undo the loader's V flip, the normal map was baked against the file's UV orientation
+                    uv[k] = glm::vec2(vertex.texCoord.x, 1.0f - vertex.texCoord.y);
+                }
+                glm::vec3 e1 = p[1] - p[0];
+                glm::vec3 e2 = p[2] - p[0];
+                glm::vec2 d1 = uv[1] - uv[0];
+                glm::vec2 d2 = uv[2] - uv[0];
+                float signedArea = d1.x * d2.y - d2.x * d1.y;
+                if (std::fabs(signedArea) < 1e-12f) {
+                    continue;
+                }
+                glm::vec3 faceTangent = (e1 * d2.y - e2 * d1.y) / signedArea;
+                glm::vec3 faceBitangent = (e2 * d1.x - e1 * d2.x) / signedArea;
+
+                for (uint32_t k = 0; k < 3; k++) {
+                    uint32_t vertex = indices[i + k];
+                    const glm::vec3 &normal = vertices[vertex].normal;
+                    glm::vec3 tangent = faceTangent - normal * glm::dot(normal, faceTangent);
+                    float length = glm::length(tangent);
+                    if (length <= 0.0f) {
+                        continue;
+                    }
+                    bool negative = glm::dot(glm::cross(normal, faceTangent), faceBitangent) < 0.0f;
+                    // Measured between the edges projected onto the normal's plane, as MikkTSpace does
+                    glm::vec3 edge1 = p[(k + 1) % 3] - p[k];
+                    glm::vec3 edge2 = p[(k + 2) % 3] - p[k];
+                    float angle = cornerAngle(edge1 - normal * glm::dot(normal, edge1), edge2 - normal * glm::dot(normal, edge2));
+                    size_t slot = vertex * 2 + (negative ? 1 : 0);
+                    tangents[slot] += tangent * (angle / length);
+                    used[slot] = true;
+                    mirrored[i + k] = negative;
+                }
+            }
+
+            // A vertex used by both handedness keeps the regular one and gets a copy for the mirrored faces
+            std::vector<uint32_t> mirroredCopies(vertexCount, INVALID_VERTEX);
+            for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+                for (uint32_t side = 0; side < 2; side++) {
+                    size_t slot = vertex * 2 + side;
+                    if (!used[slot] && (side == 1 || used[slot + 1])) {
+                        continue;
+                    }
+                    const glm::vec3 &normal = vertices[vertex].normal;
+                    glm::vec3 tangent = tangents[slot] - normal * glm::dot(normal, tangents[slot]);
+                    float length = glm::length(tangent);
+                    tangent = length > 0.0f ? tangent / length : perpendicular(normal);
+                    glm::vec4 result(tangent, side == 1 ? -1.0f : 1.0f);
+                    if (side == 1 && used[vertex * 2]) {
+                        mirroredCopies[vertex] = static_cast<uint32_t>(vertices.size());
+                        vertices.push_back(vertices[vertex]);
+                        vertices.back().tangent = result;
+                    } else {
+                        vertices[vertex].tangent = result;
+                    }
+                }
+            }
+            for (size_t i = 0; i < indices.size(); i++) {
+                if (mirrored[i] && mirroredCopies[indices[i]] != INVALID_VERTEX) {
+                    indices[i] = mirroredCopies[indices[i]];
+                }
+            }
+        }
+    }
+}
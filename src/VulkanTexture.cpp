@@ -13,11 +13,32 @@ namespace VulkanBase {
         if (sampler != nullptr) {
             vkDestroySampler(pDevice->logicalDevice, sampler, nullptr);
         }
-        vkFreeMemory(pDevice->logicalDevice, deviceMemory, nullptr);
+        pDevice->allocator->free(allocation);
+    }
+
+    void Texture::retire() {
+        VkDevice logicalDevice = pDevice->logicalDevice;
+        MemoryAllocator *allocator = pDevice->allocator;
+        VkImage oldImage = image;
+        VkImageView oldImageView = imageView;
+        VkSampler oldSampler = sampler;
+        Allocation oldAllocation = allocation;
+        pDevice->retire([logicalDevice, allocator, oldImage, oldImageView, oldSampler, oldAllocation]() mutable {
+            vkDestroyImageView(logicalDevice, oldImageView, nullptr);
+            vkDestroyImage(logicalDevice, oldImage, nullptr);
+            if (oldSampler != nullptr) {
+                vkDestroySampler(logicalDevice, oldSampler, nullptr);
+            }
+            allocator->free(oldAllocation);
+        });
+        image = VK_NULL_HANDLE;
+        imageView = VK_NULL_HANDLE;
+        sampler = VK_NULL_HANDLE;
+        allocation = Allocation();
     }
 
     void Texture2D::loadFromFile(const std::string& filePath, VkFormat format, VulkanBase::VulkanDevice *device,
-                                 VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout) {
+                                 VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout, AsyncUpload *batch) {
         this->pDevice = device;
 
         std::cout << "Loading New Image: " << filePath << std::endl;
@@ -33,33 +54,9 @@ namespace VulkanBase {
         std::cout << " Image Width: " << width << std::endl;
         std::cout << " Image Height: " << height << std::endl;
 
-        VkCommandBuffer copyCommand = pDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-        VkBuffer stagingBuffer;
-        VkMemoryRequirements memoryRequirements;
-        VkMemoryAllocateInfo allocateInfo{};
-        VkDeviceMemory stagingMemory;
-
-        VkBufferCreateInfo bufferCreateInfo{};
-        bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferCreateInfo.size = imageSize;
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        VK_CHECK_RESULT(vkCreateBuffer(pDevice->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-        vkGetBufferMemoryRequirements(pDevice->logicalDevice, stagingBuffer, &memoryRequirements);
-
-        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocateInfo.allocationSize = memoryRequirements.size;
-        allocateInfo.memoryTypeIndex = pDevice->getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        VK_CHECK_RESULT(vkAllocateMemory(pDevice->logicalDevice, &allocateInfo, nullptr, &stagingMemory));
-        VK_CHECK_RESULT(vkBindBufferMemory(pDevice->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-        void *data;
-        VK_CHECK_RESULT(vkMapMemory(pDevice->logicalDevice, stagingMemory, 0, imageSize, 0, &data));
-        memcpy(data, pixels, static_cast<uint32_t>(imageSize));
-        vkUnmapMemory(pDevice->logicalDevice, stagingMemory);
+        AsyncUpload *upload = batch != nullptr ? batch : pDevice->beginUpload();
 
+        StagingRegion staging = pDevice->stage(upload, pixels, imageSize);
         stbi_image_free(pixels);
 
         VkImageCreateInfo imageCreateInfo{};
@@ -79,11 +76,7 @@ namespace VulkanBase {
         imageCreateInfo.extent = {width, height, 1};
         imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         VK_CHECK_RESULT(vkCreateImage(pDevice->logicalDevice, &imageCreateInfo, nullptr, &image));
-        vkGetImageMemoryRequirements(pDevice->logicalDevice, image, &memoryRequirements);
-        allocateInfo.allocationSize = memoryRequirements.size;
-        allocateInfo.memoryTypeIndex = pDevice->getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        VK_CHECK_RESULT(vkAllocateMemory(pDevice->logicalDevice, &allocateInfo, nullptr, &deviceMemory));
-        VK_CHECK_RESULT(vkBindImageMemory(pDevice->logicalDevice, image, deviceMemory, 0));
+        allocation = pDevice->allocator->allocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, MemoryCategory::Texture);
 
         VkImageSubresourceRange subresourceRange{};
         subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -91,10 +84,11 @@ namespace VulkanBase {
         subresourceRange.levelCount = 1;
         subresourceRange.layerCount = 1;
 
-        VulkanBase::Tools::setImageLayout(copyCommand, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+        VulkanBase::Tools::setImageLayout(upload->commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange,
+                                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
         VkBufferImageCopy region{};
-        region.bufferOffset = 0;
+        region.bufferOffset = staging.offset;
         region.bufferRowLength = 0;
         region.bufferImageHeight = 0;
         region.imageExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1};
@@ -104,14 +98,12 @@ namespace VulkanBase {
         region.imageSubresource.layerCount = 1;
         region.imageSubresource.mipLevel = 0;
 
-        vkCmdCopyBufferToImage(copyCommand, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,&region);
+        vkCmdCopyBufferToImage(upload->commandBuffer, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,&region);
         this->imageLayout = imageLayout;
-        VulkanBase::Tools::setImageLayout(copyCommand, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout, subresourceRange);
-
-        pDevice->flushCommandBuffer(copyCommand, pDevice->graphicsQueue, true);
-
-        vkDestroyBuffer(pDevice->logicalDevice, stagingBuffer, nullptr);
-        vkFreeMemory(pDevice->logicalDevice, stagingMemory, nullptr);
+        pDevice->releaseImage(upload, image, subresourceRange, imageLayout, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        if (batch == nullptr) {
+            pDevice->submitUpload(upload);
+        }
 
         VkSamplerCreateInfo samplerInfo{};
         samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -149,7 +141,7 @@ namespace VulkanBase {
         imageInfo.imageView = imageView;
     }
 
-    void TextureCubeMap::loadFromFiles(const std::array<std::string, 6> &filePaths, VkFormat format, VulkanDevice *device, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout) {
+    void TextureCubeMap::loadFromFiles(const std::array<std::string, 6> &filePaths, VkFormat format, VulkanDevice *device, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout, AsyncUpload *batch) {
         this->pDevice = device;
 
         int texWidth, texHeight, channels;
@@ -168,30 +160,12 @@ namespace VulkanBase {
         height = static_cast<uint32_t>(texHeight);
         VkDeviceSize imageSize = width * height * 4 * sizeof(stbi_uc);
 
-        VkBuffer stagingBuffer;
-        VkMemoryRequirements memoryRequirements;
-        VkMemoryAllocateInfo allocateInfo{};
-        VkDeviceMemory stagingMemory;
-
-        VkBufferCreateInfo bufferCreateInfo{};
-        bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferCreateInfo.size = imageSize * 6;
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        VK_CHECK_RESULT(vkCreateBuffer(pDevice->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-        vkGetBufferMemoryRequirements(pDevice->logicalDevice, stagingBuffer, &memoryRequirements);
-
-        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocateInfo.allocationSize = memoryRequirements.size;
-        allocateInfo.memoryTypeIndex = pDevice->getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        AsyncUpload *upload = batch != nullptr ? batch : pDevice->beginUpload();
+        StagingRegion staging = pDevice->stage(upload, nullptr, imageSize * 6);
 
-        VK_CHECK_RESULT(vkAllocateMemory(pDevice->logicalDevice, &allocateInfo, nullptr, &stagingMemory));
-        VK_CHECK_RESULT(vkBindBufferMemory(pDevice->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-        char* data = nullptr;
+        char* data = static_cast<char*>(staging.mapped);
         size_t offset = 0;
         std::vector<size_t> offsets(6);
-        VK_CHECK_RESULT(vkMapMemory(pDevice->logicalDevice, stagingMemory, 0, imageSize * 6, 0, (void**)&data));
         for (uint32_t i = 0; i < 6; i++) {
             data += offset;
             memcpy(data, pixels[i], imageSize * sizeof(stbi_uc));
@@ -201,7 +175,6 @@ namespace VulkanBase {
         for (int i = 1; i < 6; i++) {
                 offsets[i] += imageSize + offsets[i - 1];
         }
-        vkUnmapMemory(pDevice->logicalDevice, stagingMemory);
 
         for (auto& pixel : pixels) {
             stbi_image_free(pixel);
@@ -216,7 +189,7 @@ namespace VulkanBase {
             copyRegion.imageSubresource.baseArrayLayer = face;
             copyRegion.imageSubresource.layerCount = 1;
             copyRegion.imageExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1};
-            copyRegion.bufferOffset = offsets[face];
+            copyRegion.bufferOffset = staging.offset + offsets[face];
             copyRegions.push_back(copyRegion);
         }
 
@@ -238,14 +211,7 @@ namespace VulkanBase {
         imageCreateInfo.arrayLayers = 6;
         imageCreateInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
         VK_CHECK_RESULT(vkCreateImage(pDevice->logicalDevice, &imageCreateInfo, nullptr, &image));
-
-        vkGetImageMemoryRequirements(pDevice->logicalDevice, image, &memoryRequirements);
-        allocateInfo.allocationSize = memoryRequirements.size;
-        allocateInfo.memoryTypeIndex = pDevice->getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        VK_CHECK_RESULT(vkAllocateMemory(pDevice->logicalDevice, &allocateInfo, nullptr, &deviceMemory));
-        VK_CHECK_RESULT(vkBindImageMemory(pDevice->logicalDevice, image, deviceMemory, 0));
-
-        VkCommandBuffer copyCommand = pDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+        allocation = pDevice->allocator->allocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, MemoryCategory::Texture);
 
         VkImageSubresourceRange subresourceRange{};
         subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -253,14 +219,16 @@ namespace VulkanBase {
         subresourceRange.levelCount = 1;
         subresourceRange.layerCount = 6;
 
-        VulkanBase::Tools::setImageLayout(copyCommand, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+        VulkanBase::Tools::setImageLayout(upload->commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange,
+                                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
-        vkCmdCopyBufferToImage(copyCommand, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+        vkCmdCopyBufferToImage(upload->commandBuffer, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
 
         this->imageLayout = imageLayout;
-        VulkanBase::Tools::setImageLayout( copyCommand, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout, subresourceRange);
-
-        device->flushCommandBuffer(copyCommand, pDevice->graphicsQueue, true);
+        pDevice->releaseImage(upload, image, subresourceRange, imageLayout, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        if (batch == nullptr) {
+            device->submitUpload(upload);
+        }
 
         VkSamplerCreateInfo samplerCreateInfo{};
         samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -289,9 +257,6 @@ namespace VulkanBase {
         viewCreateInfo.image = image;
         VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &imageView));
 
-        vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-        vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-
         imageInfo.sampler = sampler;
         imageInfo.imageLayout = imageLayout;
         imageInfo.imageView = imageView;
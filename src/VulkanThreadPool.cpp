@@ -0,0 +1,73 @@
+#include "VulkanThreadPool.h"
+
+#include <algorithm>
+
+namespace VulkanBase {
+    ThreadPool::ThreadPool(uint32_t threadCount) {
+        threadCount = std::max(threadCount, 1u);
+        for (uint32_t i = 0; i < threadCount; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    uint32_t ThreadPool::size() const {
+        return static_cast<uint32_t>(workers.size());
+    }
+
+    void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)> &task) {
+        if (count == 0) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        currentTask = &task;
+        taskCount = count;
+        nextTask = 0;
+        finishedTasks = 0;
+        error = nullptr;
+        workAvailable.notify_all();
+        workFinished.wait(lock, [this] { return finishedTasks == taskCount; });
+        currentTask = nullptr;
+        taskCount = 0;
+        nextTask = 0;
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    void ThreadPool::workerLoop(uint32_t threadIndex) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            workAvailable.wait(lock, [this] { return stopping || nextTask < taskCount; });
+            if (stopping) {
+                return;
+            }
+            uint32_t taskIndex = nextTask++;
+            const std::function<void(uint32_t, uint32_t)> *task = currentTask;
+            lock.unlock();
+            std::exception_ptr taskError;
+            try {
+                (*task)(taskIndex, threadIndex);
+            } catch (...) {
+                taskError = std::current_exception();
+            }
+            lock.lock();
+            if (taskError && !error) {
+                error = taskError;
+            }
+            if (++finishedTasks == taskCount) {
+                workFinished.notify_one();
+            }
+        }
+    }
+}
@@ -216,3 +216,27 @@ std::string VulkanBase::Tools::errorString(VkResult res) {
 uint32_t VulkanBase::Tools::alignedSize(uint32_t val, uint32_t alignment) {
     return (val + alignment - 1) & ~(alignment - 1);
 }
+
+VkDeviceSize VulkanBase::Tools::alignedVkSize(VkDeviceSize val, VkDeviceSize alignment) {
+    return (val + alignment - 1) & ~(alignment - 1);
+}
+
+void VulkanBase::Tools::writePPM(const std::string &filePath, const unsigned char *rgba, uint32_t width, uint32_t height) {
+    std::ofstream file(filePath, std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open file: " + filePath + "!");
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    // PPM has no alpha channel
+    std::vector<unsigned char> row(width * 3);
+    for (uint32_t y = 0; y < height; y++) {
+        const unsigned char *src = rgba + (size_t)y * width * 4;
+        for (uint32_t x = 0; x < width; x++) {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        file.write(reinterpret_cast<const char *>(row.data()), row.size());
+    }
+    file.close();
+}
@@ -0,0 +1,40 @@
+#include "VulkanUniformAllocator.h"
+
+#include <stdexcept>
+
+namespace VulkanBase {
+    UniformAllocator::UniformAllocator(VulkanDevice *device, uint32_t frameCount, VkDeviceSize frameSize) {
+        alignment = device->properties.limits.minUniformBufferOffsetAlignment;
+        this->frameSize = Tools::alignedVkSize(frameSize, alignment);
+        device->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                             &buffer, this->frameSize * frameCount);
+        buffer.map();
+    }
+
+    UniformAllocator::~UniformAllocator() {
+        buffer.cleanUp();
+    }
+
+    void UniformAllocator::beginFrame(uint32_t frameIndex) {
+        frameStart = frameIndex * frameSize;
+        head = frameStart;
+    }
+
+    uint32_t UniformAllocator::allocate(VkDeviceSize size) {
+        VkDeviceSize offset = head;
+        VkDeviceSize end = offset + Tools::alignedVkSize(size, alignment);
+        if (end > frameStart + frameSize) {
+            throw std::runtime_error("uniform allocator frame region is full!");
+        }
+        head = end;
+        return static_cast<uint32_t>(offset);
+    }
+
+    void *UniformAllocator::mapped(uint32_t offset) const {
+        return static_cast<char *>(buffer.mapped) + offset;
+    }
+
+    VkDescriptorBufferInfo UniformAllocator::descriptor(VkDeviceSize range) const {
+        return {buffer.buffer, 0, range};
+    }
+}
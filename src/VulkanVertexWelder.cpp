@@ -0,0 +1,67 @@
+#include "VulkanVertexWelder.h"
+
+#include <cstring>
+
+namespace VulkanBase {
+    VertexWelder::VertexWelder(std::vector<Vertex> &vertices, size_t expectedVertices) : vertices(vertices) {
+        // Keep the load factor under one half so probe chains stay short
+        size_t capacity = 64;
+        while (capacity < (vertices.size() + expectedVertices) * 2) {
+            capacity *= 2;
+        }
+        rehash(capacity);
+    }
+
+    uint32_t VertexWelder::weld(const Vertex &vertex) {
+        uint32_t slot = hash(vertex) & mask;
+        while (slots[slot] != 0) {
+            uint32_t index = slots[slot] - 1;
+            if (equal(vertices[index], vertex)) {
+                return index;
+            }
+            slot = (slot + 1) & mask;
+        }
+        uint32_t index = static_cast<uint32_t>(vertices.size());
+        vertices.push_back(vertex);
+        slots[slot] = index + 1;
+        if (vertices.size() * 2 > slots.size()) {
+            rehash(slots.size() * 2);
+        }
+        return index;
+    }
+
+    uint32_t VertexWelder::hash(const Vertex &vertex) {
+        // Bitwise key over the welded attributes, the tangent is derived later and never part of it
+        uint32_t bits[8];
+        std::memcpy(bits, &vertex.pos, sizeof(float) * 3);
+        std::memcpy(bits + 3, &vertex.texCoord, sizeof(float) * 2);
+        std::memcpy(bits + 5, &vertex.normal, sizeof(float) * 3);
+        uint32_t h = 2166136261u;
+        for (uint32_t word : bits) {
+            h = (h ^ word) * 16777619u;
+        }
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        return h;
+    }
+
+    bool VertexWelder::equal(const Vertex &a, const Vertex &b) {
+        return std::memcmp(&a.pos, &b.pos, sizeof(float) * 3) == 0 &&
+               std::memcmp(&a.texCoord, &b.texCoord, sizeof(float) * 2) == 0 &&
+               std::memcmp(&a.normal, &b.normal, sizeof(float) * 3) == 0;
+    }
+
+    void VertexWelder::rehash(size_t capacity) {
+        // Vertices already in the array are indexed as they are, duplicates among them stay
+        slots.assign(capacity, 0);
+        mask = static_cast<uint32_t>(slots.size() - 1);
+        for (uint32_t index = 0; index < vertices.size(); index++) {
+            uint32_t slot = hash(vertices[index]) & mask;
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = index + 1;
+        }
+    }
+}
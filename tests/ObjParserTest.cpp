@@ -0,0 +1,94 @@
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "VulkanModel.h"
+#include "VulkanObjParser.h"
+#include "VulkanThreadPool.h"
+
+// Loads OBJ files through ObjParser and through Model's tinyobj path and fails unless both produce the same vertices and
+// indices. Usage: ObjParserTest <fixture directory>
+
+// Large enough for ObjParser to split it into several chunks, with relative indices reaching back across chunk borders
+static std::string writeChunkedFile(const std::string &filePath) {
+    const int gridSize = 400;
+    std::ofstream file(filePath);
+    file << "# generated by ObjParserTest\no grid\n";
+    for (int y = 0; y <= gridSize; y++) {
+        for (int x = 0; x <= gridSize; x++) {
+            // Mixed notations exercise the float parsing of both loaders
+            if ((x + y) % 2 == 0) {
+                file << std::fixed << std::setprecision(6);
+            } else {
+                file << std::scientific << std::setprecision(4);
+            }
+            file << "v " << x * 0.37f << " " << std::sin(x * 0.1f + y) * 50.0f << " " << y * -0.013f << "\n";
+        }
+    }
+    file << std::fixed << std::setprecision(5);
+    for (int y = 0; y <= gridSize; y++) {
+        for (int x = 0; x <= gridSize; x++) {
+            file << "vt " << x / static_cast<float>(gridSize) << " " << y / static_cast<float>(gridSize) << "\n";
+        }
+    }
+    file << "vn 0 0 1\nvn 0 1 0\ng faces\n";
+    for (int y = 0; y < gridSize; y++) {
+        for (int x = 0; x < gridSize; x++) {
+            int i = y * (gridSize + 1) + x + 1;
+            int j = i + gridSize + 1;
+            switch ((x + y) % 4) {
+                case 0:
+                    file << "f " << i << "/" << i << "/1 " << i + 1 << "/" << i + 1 << "/1 " << j + 1 << "/" << j + 1 << "/1 " << j << "/" << j
+                         << "/1\n";
+                    break;
+                case 1:
+                    file << "f " << i << "//2 " << i + 1 << "//2 " << j << "//2\nf " << i + 1 << " " << j + 1 << " " << j << "\r\n";
+                    break;
+                case 2:
+                    file << "f " << i << "/" << i << " " << i + 1 << "/" << i + 1 << " " << j << "/" << j << "\n";
+                    break;
+                default:
+                    // Each row appends a triangle addressed from the end of everything read so far
+                    file << "v " << x << " " << y << " 1\nf -1 " << i << " " << i + 1 << "\n";
+                    break;
+            }
+        }
+    }
+    return filePath;
+}
+
+static bool compare(const std::string &filePath, VulkanBase::ThreadPool &threadPool) {
+    Model reference;
+    reference.loadWithTinyObj(filePath);
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    VulkanBase::ObjParser::load(filePath, &threadPool, vertices, indices);
+
+    bool identical = vertices.size() == reference.vertices.size() && indices == reference.indices;
+    // Vertex is tightly packed floats, so comparing bytes also tells apart -0.0 and NaN payloads
+    if (identical && !vertices.empty()) {
+        identical = memcmp(vertices.data(), reference.vertices.data(), vertices.size() * sizeof(Vertex)) == 0;
+    }
+    std::cout << (identical ? "passed: " : "FAILED: ") << filePath << " (" << vertices.size() << " vertices, " << indices.size()
+              << " indices, tinyobj " << reference.vertices.size() << " and " << reference.indices.size() << ")" << std::endl;
+    return identical;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: ObjParserTest <fixture directory>" << std::endl;
+        return 1;
+    }
+    std::string fixtures(argv[1]);
+    VulkanBase::ThreadPool threadPool(4);
+    bool passed = true;
+    passed &= compare(fixtures + "/negative_indices.obj", threadPool);
+    passed &= compare(fixtures + "/quads.obj", threadPool);
+    passed &= compare(fixtures + "/missing_attributes.obj", threadPool);
+    passed &= compare(writeChunkedFile("chunked.obj"), threadPool);
+    return passed ? 0 : 1;
+}